@@ -0,0 +1,1096 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "batchsolver.h"
+#include "boardcanonicaliser.h"
+#include "boardgrader.h"
+#include "boardsearch.h"
+#include "boardsolver.h"
+#include "gridvalidator.h"
+#include "puzzlegenerator.h"
+#include "puzzletext.h"
+#include "sizedboard.h"
+#include "solverserver.h"
+#include "spscqueue.h"
+
+
+////////// CLASS BatchSolver //////////
+
+BatchSolver::BatchSolver()
+{
+    mode = NoMode;
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+    maxCount = LLONG_MAX;
+    outputFormat = TextFormat;
+    generateCount = 0;
+    difficulty = 0;
+    seed = std::random_device()();
+    cacheSize = size_t(64) << 20;
+    cache.reset(new SolutionCache);
+    corpusFlags = 0;
+    queueLimit = 1024;
+    adaptive = false;
+    chunkSize = size_t(1) << 20;
+    queueDepth = 4;
+    pipelineStats = false;
+}
+
+/*static*/ bool BatchSolver::isBatchOption(const char *arg)
+{
+    // return whether a (first) command line argument asks for batch rather than the GUI
+    static const char *const modeOptions[] = { "--check-unique", "--enumerate", "--generate", "--grade", "--dedupe", "--solve", "--to-corpus", "--from-corpus", "--serve", "--validate" };
+    for (const char *option : modeOptions)
+        if (std::strcmp(arg, option) == 0)
+            return true;
+    return false;
+}
+
+void BatchSolver::usage() const
+{
+    std::cerr << "Usage: sudokusolver --check-unique [PIPELINE OPTIONS] [--threads N] [--checkpoint FILE] [--output FILE] [INPUT]" << std::endl
+              << "       sudokusolver --solve [--cache FILE [--cache-size MB]] [PIPELINE OPTIONS] [--threads N] [--checkpoint FILE] [--output FILE] [INPUT]" << std::endl
+              << "       sudokusolver --enumerate [--max N] [--cursor-file FILE] [--format text|packed] [--threads N] [--output FILE] [INPUT]" << std::endl
+              << "       sudokusolver --grade [--adaptive] [--cache FILE [--cache-size MB]] [PIPELINE OPTIONS] [--threads N] [--checkpoint FILE] [--output FILE] [INPUT]" << std::endl
+              << "       sudokusolver --validate [PIPELINE OPTIONS] [--threads N] [--output FILE] [INPUT]" << std::endl
+              << "       sudokusolver --dedupe [PIPELINE OPTIONS] [--threads N] [--output FILE] [INPUT]" << std::endl
+              << "       sudokusolver --to-corpus [--with-solutions] [--with-grades] [PIPELINE OPTIONS] [--threads N] --output FILE [INPUT]" << std::endl
+              << "       sudokusolver --from-corpus [--format text|saves] [--output FILE] INPUT" << std::endl
+              << "       sudokusolver --generate N [--difficulty D] [--seed S] [--threads N] [--output FILE]" << std::endl
+              << "       sudokusolver --serve SOCKET [--queue N] [--cache FILE [--cache-size MB]] [--threads N]" << std::endl
+              << "  --check-unique      report whether each puzzle has 0, 1 or many solutions" << std::endl
+              << "  --solve             write out the solution of each puzzle (or 0 or \"many\" if it has none or more than one)" << std::endl
+              << "                      (--check-unique and --solve also take 4x4, 16x16 and 25x25 boards: 16, 256 or 625 characters," << std::endl
+              << "                      \"1\"-\"9\" and then \"A\" on for 10 up)" << std::endl
+              << "  --enumerate         write out every solution of the (first) puzzle" << std::endl
+              << "  --grade             rate each puzzle and count the steps each solver pass found, then show how many are in each tier" << std::endl
+              << "  --adaptive          try the solver's techniques cheapest per hit first, as measured over the puzzles so far" << std::endl
+              << "                      (quicker, but not reproducible: the order follows measured times, so step counts and ratings" << std::endl
+              << "                      can differ from run to run, and a run resumed with --checkpoint from one never stopped;" << std::endl
+              << "                      the passes keep their order, so tiers are much less likely to; not with --cache)" << std::endl
+              << "  --validate          check completed grids, each a puzzle and its grid (as --solve writes them) or a grid alone:" << std::endl
+              << "                      \"valid\", \"unsolved\" (a row, column or square without each number once) or \"givens-changed\"" << std::endl
+              << "  --dedupe            copy the puzzles, leaving out any equivalent to an earlier one by symmetry or relabelling" << std::endl
+              << "  --to-corpus         convert puzzles from 81-character lines or the saves/ format to a binary corpus" << std::endl
+              << "  --with-solutions    also put each puzzle's solution (if it has just one) into the corpus" << std::endl
+              << "  --with-grades       also put each puzzle's grade into the corpus" << std::endl
+              << "  --from-corpus       convert a binary corpus back to 81-character lines or the saves/ format" << std::endl
+              << "  --generate N        make N new puzzles with one solution, written with their difficulty" << std::endl
+              << "  --difficulty D      only make puzzles of difficulty D: the hardest solver pass (1-5) they need, or 6 if they need search" << std::endl
+              << "  --seed S            seed for the random numbers, to make the same puzzles again (with any number of threads)" << std::endl
+              << "  --serve SOCKET      answer \"solve\", \"step\", \"grade\" and \"check-unique\" requests on a Unix domain socket until stopped" << std::endl
+              << "                      and \"session-...\" requests for interactive solving sessions kept by the service" << std::endl
+              << "  --queue N           most requests to hold waiting for a worker before reading no more (default: 1024)" << std::endl
+              << "  --cache FILE        keep solutions and grades in FILE, and use those already there" << std::endl
+              << "  --cache-size MB     most space for a new cache file (default: 64)" << std::endl
+              << "  --max N             stop after N solutions" << std::endl
+              << "  --cursor-file FILE  resume from the cursor in FILE (if it exists), and save the cursor there at the end" << std::endl
+              << "  --format FORMAT     \"text\" for 81 characters and a newline, \"packed\" for 41 bytes of 2 numbers each," << std::endl
+              << "                      \"saves\" for 9 lines of 9 numbers" << std::endl
+              << "  --checkpoint FILE   every so often save how far the run has got to FILE, and resume from there if it exists" << std::endl
+              << "                      (needs INPUT and --output FILE; FILE is removed once the run is complete)" << std::endl
+              << "  PIPELINE OPTIONS    (reading, solving and writing go on at once, with blocks of the input queued between them;" << std::endl
+              << "                      for --check-unique, --solve, --grade, --validate, --dedupe and --to-corpus)" << std::endl
+              << "  --queue-depth N     most blocks to queue between reading and solving, and solving and writing (default: 4)" << std::endl
+              << "  --chunk-size KB     size of the blocks the input is read in, or of their puzzles from a corpus (default: 1024)" << std::endl
+              << "  --pipeline-stats    at the end, show how long the reading, solving and writing each waited for the others" << std::endl
+              << "  --threads N         number of worker threads (default: number of cores)" << std::endl
+              << "  --output FILE       write results to FILE (default: standard output)" << std::endl
+              << "  INPUT               file of puzzles, one per line, or a binary corpus (default: standard input)" << std::endl;
+}
+
+bool BatchSolver::parseArguments(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--check-unique")
+            mode = CheckUnique;
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threadCount = std::atoi(argv[++i]);
+            if (threadCount < 1)
+                return false;
+        }
+        else if (arg == "--enumerate")
+            mode = Enumerate;
+        else if (arg == "--grade")
+            mode = Grade;
+        else if (arg == "--adaptive")
+            adaptive = true;
+        else if (arg == "--solve")
+            mode = Solve;
+        else if (arg == "--cache" && i + 1 < argc)
+            cachePath = argv[++i];
+        else if (arg == "--cache-size" && i + 1 < argc)
+        {
+            long long megabytes = std::atoll(argv[++i]);
+            if (megabytes < 1)
+                return false;
+            cacheSize = size_t(megabytes) << 20;
+        }
+        else if (arg == "--to-corpus")
+            mode = ToCorpus;
+        else if (arg == "--with-solutions")
+            corpusFlags |= CorpusHasSolutions;
+        else if (arg == "--with-grades")
+            corpusFlags |= CorpusHasGrades;
+        else if (arg == "--from-corpus")
+            mode = FromCorpus;
+        else if (arg == "--dedupe")
+            mode = Dedupe;
+        else if (arg == "--validate")
+            mode = Validate;
+        else if (arg == "--serve" && i + 1 < argc)
+        {
+            mode = Serve;
+            socketPath = argv[++i];
+        }
+        else if (arg == "--queue" && i + 1 < argc)
+        {
+            long long limit = std::atoll(argv[++i]);
+            if (limit < 1)
+                return false;
+            queueLimit = size_t(limit);
+        }
+        else if (arg == "--queue-depth" && i + 1 < argc)
+        {
+            long long depth = std::atoll(argv[++i]);
+            if (depth < 1)
+                return false;
+            queueDepth = size_t(depth);
+        }
+        else if (arg == "--chunk-size" && i + 1 < argc)
+        {
+            long long kilobytes = std::atoll(argv[++i]);
+            if (kilobytes < 1)
+                return false;
+            chunkSize = size_t(kilobytes) << 10;
+        }
+        else if (arg == "--pipeline-stats")
+            pipelineStats = true;
+        else if (arg == "--generate" && i + 1 < argc)
+        {
+            mode = Generate;
+            generateCount = std::atoll(argv[++i]);
+            if (generateCount < 1)
+                return false;
+        }
+        else if (arg == "--difficulty" && i + 1 < argc)
+        {
+            difficulty = std::atoi(argv[++i]);
+            if (difficulty < 1 || difficulty > BoardGrader::NeedsSearch)
+                return false;
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--output" && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (arg == "--max" && i + 1 < argc)
+        {
+            maxCount = std::atoll(argv[++i]);
+            if (maxCount < 1)
+                return false;
+        }
+        else if (arg == "--cursor-file" && i + 1 < argc)
+            cursorPath = argv[++i];
+        else if (arg == "--checkpoint" && i + 1 < argc)
+            checkpointPath = argv[++i];
+        else if (arg == "--format" && i + 1 < argc)
+        {
+            std::string format(argv[++i]);
+            if (format == "text")
+                outputFormat = TextFormat;
+            else if (format == "packed")
+                outputFormat = PackedFormat;
+            else if (format == "saves")
+                outputFormat = SavesFormat;
+            else
+                return false;
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+            return false;
+        else if (inputPath.empty())
+            inputPath = arg;
+        else
+            return false;
+    }
+    if (mode == ToCorpus && outputPath.empty())
+        return false;
+    if (mode == FromCorpus && inputPath.empty())
+        return false;
+    if (mode == Serve && !inputPath.empty())
+        return false;
+    if (!checkpointPath.empty() && (inputPath.empty() || outputPath.empty() || (mode != CheckUnique && mode != Solve && mode != Grade)))
+        return false;
+    return (mode != NoMode);
+}
+
+int BatchSolver::run(int argc, char *argv[])
+{
+    if (!parseArguments(argc, argv))
+    {
+        usage();
+        return 2;
+    }
+
+    std::ifstream inputFile;
+    int result = 0;
+    if (!inputPath.empty() && PuzzleCorpusReader::isCorpusFile(inputPath))
+    {
+        try {
+            corpusInput.open(inputPath);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+    else if (mode == FromCorpus)
+    {
+        std::cerr << inputPath << ": not a puzzle corpus file" << std::endl;
+        return 1;
+    }
+    else if (!inputPath.empty())
+    {
+        inputFile.open(inputPath);
+        if (!inputFile)
+        {
+            std::cerr << inputPath << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+    }
+    if (!checkpointPath.empty() && !resumeCheckpoint(inputFile))
+        return 1;
+    std::ofstream outputFile;
+    if (!outputPath.empty() && mode != ToCorpus)
+    {
+        // (when resuming, the output has been cut back to where the checkpoint was saved)
+        outputFile.open(outputPath, (checkpoint.outputDone > 0) ? std::ios::binary | std::ios::app : std::ios::binary);
+        if (!outputFile)
+        {
+            std::cerr << outputPath << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+    }
+    if (!cachePath.empty())
+    {
+        try {
+            cache->open(cachePath, cacheSize);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+    std::istream &in(inputPath.empty() ? std::cin : inputFile);
+    std::ostream &out(outputPath.empty() ? std::cout : outputFile);
+    // (the modes which share each block of the input across the threads keep one pool of them for the whole run)
+    if (mode == CheckUnique || mode == Solve || mode == Grade || mode == Validate || mode == Dedupe || mode == ToCorpus)
+        workers.reset(new WorkerPool(threadCount));
+
+    switch (mode)
+    {
+    case CheckUnique:
+        processLines(in, out, [this](const Line &line, int) { return checkUniqueLine(line); });
+        break;
+    case Solve:
+        processLines(in, out, [this](const Line &line, int) { return solveLine(line); });
+        break;
+    case Enumerate:
+        result = enumerate(in, out);
+        break;
+    case Generate:
+        result = generate(out);
+        break;
+    case Grade:
+        result = grade(in, out);
+        break;
+    case Dedupe:
+        result = dedupe(in, out);
+        break;
+    case Validate:
+        result = validate(in, out);
+        break;
+    case ToCorpus:
+        result = toCorpus(in);
+        break;
+    case FromCorpus:
+        result = fromCorpus(out);
+        break;
+    case Serve:
+        result = serve();
+        break;
+    case NoMode: break;
+    }
+    out.flush();
+    if (!out)
+        return 1;
+    if (!checkpointPath.empty() && result == 0)
+        std::remove(checkpointPath.c_str());
+    return result;
+}
+
+/*static*/ bool BatchSolver::parsePuzzleLine(const Line &line, BoardState &state)
+{
+    // (see `PuzzleTextParser::parseLine()`)
+    return PuzzleTextParser::parseLine(line.text, line.length, state);
+}
+
+/*static*/ void BatchSolver::writeBoard(PuzzleTextWriter &writer, const BoardState &state, OutputFormat format)
+{
+    switch (format)
+    {
+    case TextFormat: writer.writeBoardLine(state); break;
+    case PackedFormat: writer.writeBoardPacked(state); break;
+    case SavesFormat: writer.writeBoardSaves(state); break;
+    }
+}
+
+bool BatchSolver::readBlock(std::istream &in, uint64_t &inputRead, std::string &block) const
+{
+    // read the next block of about `chunkSize` bytes of the input, running on to the end of the line it stops in,
+    // and move `inputRead` on past it
+    // from a corpus, the block is the puzzles of the next records as 81-character lines, read straight from the mapped file
+    // (and `inputRead` counts records)
+    // return false if there was nothing left to read
+    if (corpusInput.size() > 0)
+    {
+        size_t first = size_t(std::min(inputRead, uint64_t(corpusInput.size())));
+        size_t count = std::min(std::max(chunkSize / 82, size_t(1)), corpusInput.size() - first);
+        block.resize(count * 82);
+        for (size_t index = 0; index < count; index++)
+        {
+            corpusInput.record(first + index).puzzleText(&block[index * 82]);
+            block[index * 82 + 81] = '\n';
+        }
+        inputRead = first + count;
+        return !block.empty();
+    }
+    block.resize(chunkSize);
+    in.read(&block[0], std::streamsize(chunkSize));
+    block.resize(size_t(in.gcount()));
+    std::string rest;
+    if (block.size() == chunkSize && block.back() != '\n' && std::getline(in, rest))
+        block.append(rest).push_back('\n');
+    inputRead += block.size();
+    return !block.empty();
+}
+
+bool BatchSolver::readChunk(std::istream &in, uint64_t &inputRead, Chunk &chunk) const
+{
+    // read the next block of the input, and split it into lines (which point into the block)
+    // return false if there was nothing left to read
+    chunk.lines.clear();
+    if (!readBlock(in, inputRead, chunk.block))
+        return false;
+    chunk.inputEnd = inputRead;
+    const char *pos = chunk.block.data(), *end = chunk.block.data() + chunk.block.size();
+    while (pos < end)
+    {
+        const char *newline = static_cast<const char *>(std::memchr(pos, '\n', size_t(end - pos)));
+        const char *lineEnd = newline ? newline : end;
+        Line line;
+        line.text = pos;
+        line.length = size_t(lineEnd - pos);
+        if (line.length > 0 && pos[line.length - 1] == '\r')
+            line.length--;
+        chunk.lines.push_back(line);
+        pos = newline ? newline + 1 : end;
+    }
+    return true;
+}
+
+template<class ChunkType>
+static void runStages(size_t queueDepth, bool pipelineStats, const std::function<bool(ChunkType &chunk)> &read,
+                      const std::function<void(ChunkType &chunk)> &process, const std::function<void(ChunkType &chunk)> &write)
+{
+    // pass the input a chunk at a time from `read` to `process` to `write`, until `read` returns false
+    // the reading, the processing and the writing are stages on threads of their own, with up to `queueDepth` chunks
+    // waiting between one and the next, so the input is read and the output written while the workers are busy
+    // and memory stays the same however large the input (the writer hands used chunks back to the reader to fill again)
+    // `process` is called on the calling thread, to share each chunk out across the worker pool
+    // (a null chunk marks the end of the input)
+    typedef std::unique_ptr<ChunkType> ChunkPtr;
+    SpscQueue<ChunkPtr> toProcess(queueDepth), toWrite(queueDepth), toReuse(2 * queueDepth + 2);
+    std::thread reader([&]()
+    {
+        for (;;)
+        {
+            ChunkPtr chunk;
+            if (!toReuse.tryPop(chunk))
+                chunk.reset(new ChunkType);
+            if (!read(*chunk))
+                break;
+            toProcess.push(std::move(chunk));
+        }
+        toProcess.push(ChunkPtr());
+    });
+    std::thread writerThread([&]()
+    {
+        for (;;)
+        {
+            ChunkPtr chunk;
+            toWrite.pop(chunk);
+            if (!chunk)
+                break;
+            write(*chunk);
+            toReuse.tryPush(chunk);
+        }
+    });
+
+    for (;;)
+    {
+        ChunkPtr chunk;
+        toProcess.pop(chunk);
+        if (!chunk)
+            break;
+        process(*chunk);
+        toWrite.push(std::move(chunk));
+    }
+    toWrite.push(ChunkPtr());
+    reader.join();
+    writerThread.join();
+
+    if (pipelineStats)
+    {
+        auto seconds = [](std::chrono::nanoseconds waited) { return std::to_string(std::chrono::duration<double>(waited).count()) + "s"; };
+        std::cerr << "reader waited " << seconds(toProcess.pushWaitTime()) << " for the workers" << std::endl
+                  << "workers waited " << seconds(toProcess.popWaitTime()) << " for the reader, "
+                  << seconds(toWrite.pushWaitTime()) << " for the writer" << std::endl
+                  << "writer waited " << seconds(toWrite.popWaitTime()) << " for the workers" << std::endl;
+    }
+}
+
+void BatchSolver::processLines(std::istream &in, std::ostream &out, const LineProcessor &processLine,
+                               std::atomic<long long> counts[] /*= nullptr*/, size_t countSize /*= 0*/) const
+{
+    // read the input a block at a time, process the lines of a block across the worker pool
+    // and write out the results for the block in input order, each stage on a thread of its own (see `runStages()`)
+    // blank lines and "#" comment lines are copied through unchanged
+    // with a checkpoint file, `counts` are saved in the checkpoint as well, and picked up again from it when resuming
+    // it is saved between blocks (every 10 seconds at most), so checkpointing costs next to nothing
+    static const std::chrono::seconds checkpointInterval(10);
+    PuzzleTextWriter writer(out);
+    Checkpoint progress(checkpoint);
+    for (size_t i = 0; i < countSize && i < progress.counts.size(); i++)
+        counts[i] = progress.counts[i];
+    std::chrono::steady_clock::time_point lastSaved(std::chrono::steady_clock::now());
+    uint64_t inputRead = checkpoint.inputDone;
+
+    runStages<Chunk>(queueDepth, pipelineStats,
+        [&](Chunk &chunk) { return readChunk(in, inputRead, chunk); },
+        [&](Chunk &chunk)
+        {
+            chunk.results.resize(chunk.lines.size());
+            workers->forEachIndex(chunk.lines.size(), [&](size_t index, int worker)
+            {
+                const Line &line(chunk.lines[index]);
+                if (line.length == 0 || line.text[0] == '#')
+                    chunk.results[index].assign(line.text, line.length);
+                else
+                    chunk.results[index] = processLine(line, worker);
+            });
+            chunk.counts.assign(counts, counts + countSize);
+        },
+        [&](Chunk &chunk)
+        {
+            for (const std::string &result : chunk.results)
+                writer.writeLine(result.data(), result.size());
+            if (checkpointPath.empty() || std::chrono::steady_clock::now() - lastSaved < checkpointInterval)
+                return;
+            writer.flush();
+            out.flush();
+            progress.inputDone = std::min(chunk.inputEnd, progress.inputSize);
+            progress.outputDone = uint64_t(out.tellp());
+            progress.counts = chunk.counts;
+            if (out)
+                saveCheckpoint(progress);
+            lastSaved = std::chrono::steady_clock::now();
+        });
+}
+
+std::string BatchSolver::Checkpoint::toString() const
+{
+    // "<mode> <inputSize> <inputDone> <outputDone>" followed by the counts, all separated by spaces
+    std::string str(std::to_string(mode) + ' ' + std::to_string(inputSize) + ' ' + std::to_string(inputDone) + ' ' + std::to_string(outputDone));
+    for (long long count : counts)
+        str += ' ' + std::to_string(count);
+    return str;
+}
+
+bool BatchSolver::Checkpoint::fromString(const std::string &str)
+{
+    *this = Checkpoint();
+    std::vector<uint64_t> values;
+    const char *pos = str.c_str();
+    while (*pos != '\0')
+    {
+        if (*pos < '0' || *pos > '9')
+            return false;
+        char *end;
+        values.push_back(std::strtoull(pos, &end, 10));
+        pos = end;
+        if (*pos == ' ')
+            pos++;
+    }
+    if (values.size() < 4 || values[2] > values[1])
+        return false;
+    mode = int(values[0]);
+    inputSize = values[1];
+    inputDone = values[2];
+    outputDone = values[3];
+    counts.assign(values.begin() + 4, values.end());
+    return true;
+}
+
+bool BatchSolver::resumeCheckpoint(std::ifstream &inputFile)
+{
+    // if the checkpoint file was left by an earlier run stopped part way, carry on from where it was saved:
+    // cut the output back to the length it had then (dropping anything written after), and skip the input done
+    // return false, having said why, if it cannot be resumed
+    checkpoint = Checkpoint();
+    checkpoint.mode = mode;
+    if (corpusInput.size() > 0)
+        checkpoint.inputSize = corpusInput.size();
+    else
+    {
+        inputFile.seekg(0, std::ios::end);
+        checkpoint.inputSize = uint64_t(inputFile.tellg());
+        inputFile.seekg(0);
+    }
+    std::ifstream checkpointFile(checkpointPath);
+    if (!checkpointFile)
+        return true;
+    std::string checkpointString;
+    std::getline(checkpointFile, checkpointString);
+    Checkpoint saved;
+    if (!saved.fromString(checkpointString))
+    {
+        std::cerr << checkpointPath << ": bad checkpoint" << std::endl;
+        return false;
+    }
+    if (saved.mode != checkpoint.mode || saved.inputSize != checkpoint.inputSize)
+    {
+        std::cerr << checkpointPath << ": checkpoint is for a different run" << std::endl;
+        return false;
+    }
+    std::ifstream outputFile(outputPath, std::ios::binary | std::ios::ate);
+    if (!outputFile || uint64_t(outputFile.tellg()) < saved.outputDone)
+    {
+        std::cerr << outputPath << ": output is shorter than at the checkpoint" << std::endl;
+        return false;
+    }
+    outputFile.close();
+#ifdef _WIN32
+    std::cerr << checkpointPath << ": resuming is not supported on this platform" << std::endl;
+    return false;
+#else
+    if (::truncate(outputPath.c_str(), off_t(saved.outputDone)) != 0)
+    {
+        std::cerr << outputPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+#endif
+    if (corpusInput.size() == 0)
+        inputFile.seekg(std::streamoff(saved.inputDone));
+    checkpoint = saved;
+    std::cerr << "Resuming from checkpoint: " << checkpoint.inputDone << " of " << checkpoint.inputSize
+              << ((corpusInput.size() > 0) ? " records" : " bytes") << " done" << std::endl;
+    return true;
+}
+
+bool BatchSolver::saveCheckpoint(const Checkpoint &progress) const
+{
+    // write the checkpoint to a new file and then rename it over the old one, as for the cursor file
+    // (the output has been flushed first, so the checkpoint never claims more than has been written)
+    std::string tempPath(checkpointPath + ".tmp");
+    std::ofstream checkpointFile(tempPath);
+    checkpointFile << progress.toString() << '\n';
+    checkpointFile.close();
+    if (!checkpointFile || std::rename(tempPath.c_str(), checkpointPath.c_str()) != 0)
+    {
+        std::cerr << checkpointPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template<int BoxSize>
+static std::string sizedLineResult(const char *text, size_t length, bool withSolution)
+{
+    // " 0", " 1" or " many" for the solutions of a board of another size than 9x9
+    // or with `withSolution` its solution in place of " 1"
+    SizedBoardState<BoxSize> state, solution;
+    if (!state.parse(text, length))
+        return " invalid";
+    switch (SizedBoardSearch<BoxSize>::countSolutions(state, 2, &solution))
+    {
+    case 0: return " 0";
+    case 1: return withSolution ? ' ' + solution.toString() : " 1";
+    default: return " many";
+    }
+}
+
+/*static*/ bool BatchSolver::sizedLineResult(const Line &line, bool withSolution, std::string &result)
+{
+    // if the line is a 4x4, 16x16 or 25x25 board, append the result for it and return true
+    switch (boardLineBoxSize(line.text, line.length))
+    {
+    case 2: result += ::sizedLineResult<2>(line.text, line.length, withSolution); return true;
+    case 4: result += ::sizedLineResult<4>(line.text, line.length, withSolution); return true;
+    case 5: result += ::sizedLineResult<5>(line.text, line.length, withSolution); return true;
+    default: return false;
+    }
+}
+
+std::string BatchSolver::checkUniqueLine(const Line &line) const
+{
+    // (each line is already on a thread of its own, so the search itself is not split)
+    std::string result(line.text, line.length);
+    if (sizedLineResult(line, false, result))
+        return result;
+    BoardState state;
+    if (!parsePuzzleLine(line, state))
+        return result + " invalid";
+    switch (BoardSearch::countSolutions(state, 2))
+    {
+    case 0: return result + " 0";
+    case 1: return result + " 1";
+    default: return result + " many";
+    }
+}
+
+std::string BatchSolver::solveLine(const Line &line) const
+{
+    std::string result(line.text, line.length);
+    if (sizedLineResult(line, true, result))
+        return result;
+    BoardState state, solution;
+    if (!parsePuzzleLine(line, state))
+        return result + " invalid";
+    switch (cache->solve(state, solution))
+    {
+    case 0: return result + " 0";
+    case 1: break;
+    default: return result + " many";
+    }
+    result += ' ';
+    for (int cell = 0; cell < 81; cell++)
+        result += char('0' + solution.nums[cell]);
+    return result;
+}
+
+std::string BatchSolver::gradeLine(const Line &line, TechniqueStats *techniqueStats, std::atomic<long long> tierCounts[]) const
+{
+    // append the rating, the tier and the number of steps found by each pass, e.g. " 20031 tough 40,12,3,0,0"
+    // or " invalid" for a puzzle with no solution, or " not-unique" for one with more than one
+    // `tierCounts` has two extra entries at the end, for those
+    std::string result(line.text, line.length);
+    BoardState state;
+    if (!parsePuzzleLine(line, state) || state.checkForDuplicates())
+    {
+        tierCounts[BoardGrader::TierCount]++;
+        return result + " invalid";
+    }
+    BoardGrader::Grade grade;
+    if (cache->isOpen())
+    {
+        BoardState solution;
+        cache->solve(state, solution, &grade);
+    }
+    else
+        BoardGrader::grade(state, grade, techniqueStats);
+    if (!grade.hasOneSolution())
+    {
+        tierCounts[BoardGrader::TierCount + std::min(grade.solutionCount, 1)]++;
+        return result + ' ' + BoardGrader::solutionCountName(grade.solutionCount);
+    }
+    tierCounts[grade.tier()]++;
+    result += ' ' + std::to_string(grade.rating) + ' ' + BoardGrader::tierName(grade.tier()) + ' ';
+    for (int pass = 1; pass <= BoardGrader::PassCount; pass++)
+        result += std::to_string(grade.stepCounts[pass]) + ((pass < BoardGrader::PassCount) ? "," : "");
+    return result;
+}
+
+int BatchSolver::grade(std::istream &in, std::ostream &out) const
+{
+    // grade every puzzle, then write how many there were in each tier to stderr
+    // with `adaptive`, each worker learns the techniques' costs per hit over all the puzzles it grades in the run
+    // (the costs are measured times, and which puzzles a worker gets depends on the threads' timing,
+    // so the step counts and ratings are not reproducible, as the usage says)
+    std::atomic<long long> tierCounts[BoardGrader::TierCount + 2];
+    for (std::atomic<long long> &count : tierCounts)
+        count = 0;
+    std::vector<TechniqueStats> workerStats(static_cast<size_t>(threadCount));
+    processLines(in, out, [this, &workerStats, &tierCounts](const Line &line, int worker)
+                 { return gradeLine(line, adaptive ? &workerStats[size_t(worker)] : nullptr, tierCounts); },
+                 tierCounts, BoardGrader::TierCount + 2);
+    for (int tier = 0; tier < BoardGrader::TierCount; tier++)
+        std::cerr << BoardGrader::tierName(BoardGrader::Tier(tier)) << ": " << tierCounts[tier] << std::endl;
+    std::cerr << "invalid: " << tierCounts[BoardGrader::TierCount] << std::endl;
+    std::cerr << "not-unique: " << tierCounts[BoardGrader::TierCount + 1] << std::endl;
+    return 0;
+}
+
+/*static*/ bool BatchSolver::parseGridLine(const Line &line, uint8_t puzzle[81], uint8_t grid[81])
+{
+    // a puzzle and then its grid, separated by whitespace, or a grid alone (which has no givens to keep)
+    if (!PuzzleTextParser::parseLineNums(line.text, line.length, puzzle))
+        return false;
+    size_t pos = 81;
+    while (pos < line.length && (line.text[pos] == ' ' || line.text[pos] == '\t'))
+        pos++;
+    if (pos == line.length)
+    {
+        std::memcpy(grid, puzzle, 81);
+        std::memset(puzzle, 0, 81);
+        return true;
+    }
+    return PuzzleTextParser::parseLineNums(line.text + pos, line.length - pos, grid);
+}
+
+int BatchSolver::validate(std::istream &in, std::ostream &out) const
+{
+    // check every completed grid against its puzzle, then write how many were valid, unsolved and so on to stderr
+    // the lines of a block are parsed and checked a slice at a time across the worker pool (each slice in bulk
+    // by `GridValidator`), then written out in input order with the result, or " invalid" if not in either form,
+    // each stage on a thread of its own (see `runStages()`)
+    // blank lines and "#" comment lines are copied through unchanged
+    static const size_t sliceSize = 4096;
+    std::vector<uint8_t> puzzles, grids;
+    std::vector<char> parsed;
+    std::vector<GridValidator::Result> results;
+    long long resultCounts[GridValidator::GivensChanged + 1] = {}, invalidCount = 0;
+    PuzzleTextWriter writer(out);
+    uint64_t inputRead = 0;
+    runStages<Chunk>(queueDepth, pipelineStats,
+        [&](Chunk &chunk) { return readChunk(in, inputRead, chunk); },
+        [&](Chunk &chunk)
+        {
+            // (each line's result is the name to write after it, or empty to copy it through)
+            const std::vector<Line> &lines(chunk.lines);
+            puzzles.resize(lines.size() * 81);
+            grids.resize(lines.size() * 81);
+            parsed.resize(lines.size());
+            results.resize(lines.size());
+            workers->forEachIndex((lines.size() + sliceSize - 1) / sliceSize, [&](size_t slice, int)
+            {
+                size_t first = slice * sliceSize, count = std::min(sliceSize, lines.size() - first);
+                for (size_t index = first; index < first + count; index++)
+                {
+                    parsed[index] = parseGridLine(lines[index], &puzzles[index * 81], &grids[index * 81]);
+                    if (!parsed[index])
+                        std::memset(&grids[index * 81], 0, 81);
+                }
+                GridValidator::validate(reinterpret_cast<const uint8_t (*)[81]>(&grids[first * 81]),
+                                        reinterpret_cast<const uint8_t (*)[81]>(&puzzles[first * 81]), count, &results[first]);
+            });
+            chunk.results.resize(lines.size());
+            for (size_t index = 0; index < lines.size(); index++)
+            {
+                if (lines[index].length == 0 || lines[index].text[0] == '#')
+                    chunk.results[index].clear();
+                else if (parsed[index])
+                {
+                    chunk.results[index] = GridValidator::resultName(results[index]);
+                    resultCounts[results[index]]++;
+                }
+                else
+                {
+                    chunk.results[index] = "invalid";
+                    invalidCount++;
+                }
+            }
+        },
+        [&](Chunk &chunk)
+        {
+            for (size_t index = 0; index < chunk.lines.size(); index++)
+            {
+                const Line &line(chunk.lines[index]);
+                const std::string &result(chunk.results[index]);
+                if (result.empty())
+                {
+                    writer.writeLine(line.text, line.length);
+                    continue;
+                }
+                writer.write(line.text, line.length);
+                writer.write(" ", 1);
+                writer.writeLine(result.data(), result.size());
+            }
+        });
+    writer.flush();
+    for (int result = 0; result <= GridValidator::GivensChanged; result++)
+        std::cerr << GridValidator::resultName(GridValidator::Result(result)) << ": " << resultCounts[result] << std::endl;
+    std::cerr << "invalid: " << invalidCount << std::endl;
+    return 0;
+}
+
+int BatchSolver::dedupe(std::istream &in, std::ostream &out) const
+{
+    // copy the input, leaving out each puzzle whose canonical form has been seen before
+    // the canonical forms of a block are found across the worker pool, and then checked in input order
+    // so the first of each set of equivalent puzzles is the one kept (the block's lines are cut down to those kept,
+    // for the writer), each stage on a thread of its own (see `runStages()`)
+    // lines which are not puzzles are copied through unchanged
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> canonicalForms;
+    long long puzzleCount = 0;
+    PuzzleTextWriter writer(out);
+    uint64_t inputRead = 0;
+    runStages<Chunk>(queueDepth, pipelineStats,
+        [&](Chunk &chunk) { return readChunk(in, inputRead, chunk); },
+        [&](Chunk &chunk)
+        {
+            std::vector<Line> &lines(chunk.lines);
+            canonicalForms.resize(lines.size());
+            workers->forEachIndex(lines.size(), [&](size_t index, int)
+            {
+                // one canonicaliser per thread, to reuse its work space
+                thread_local BoardCanonicaliser canonicaliser;
+                BoardState state;
+                if (parsePuzzleLine(lines[index], state))
+                    canonicalForms[index] = canonicaliser.canonicalString(state);
+                else
+                    canonicalForms[index].clear();
+            });
+            size_t keptCount = 0;
+            for (size_t index = 0; index < lines.size(); index++)
+            {
+                if (!canonicalForms[index].empty())
+                {
+                    puzzleCount++;
+                    if (!seen.insert(canonicalForms[index]).second)
+                        continue;
+                }
+                lines[keptCount++] = lines[index];
+            }
+            lines.resize(keptCount);
+        },
+        [&](Chunk &chunk)
+        {
+            for (const Line &line : chunk.lines)
+                writer.writeLine(line.text, line.length);
+        });
+    writer.flush();
+    std::cerr << puzzleCount << " puzzles, " << seen.size() << " unique" << std::endl;
+    return 0;
+}
+
+int BatchSolver::toCorpus(std::istream &in) const
+{
+    // read puzzles in any form `PuzzleTextParser` takes, and write them to a corpus,
+    // solving and grading them across the worker pool if asked, each stage on a thread of its own (see `runStages()`)
+    // stop at the first line which cannot be parsed
+    PuzzleCorpusWriter writer;
+    try {
+        writer.open(outputPath, corpusFlags);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::string block;
+    uint64_t inputRead = 0;
+    PuzzleTextParser parser;
+    PuzzleTextParser::Result result = PuzzleTextParser::End;
+    runStages<PuzzleChunk>(queueDepth, pipelineStats,
+        [&](PuzzleChunk &chunk)
+        {
+            // (the puzzles parsed before an error are still written)
+            if (result == PuzzleTextParser::Error)
+                return false;
+            if (!readBlock(in, inputRead, block))
+            {
+                result = parser.finish();
+                return false;
+            }
+            chunk.puzzles.clear();
+            parser.setText(block.data(), block.size());
+            BoardState state;
+            while ((result = parser.next(state)) == PuzzleTextParser::Parsed)
+                chunk.puzzles.push_back(state);
+            return true;
+        },
+        [&](PuzzleChunk &chunk)
+        {
+            chunk.solutions.resize(chunk.puzzles.size());
+            chunk.grades.assign(chunk.puzzles.size(), BoardGrader::Grade());
+            chunk.solutionCounts.assign(chunk.puzzles.size(), 0);
+            if (corpusFlags != 0)
+                workers->forEachIndex(chunk.puzzles.size(), [&](size_t index, int)
+                {
+                    if (corpusFlags & CorpusHasSolutions)
+                        chunk.solutionCounts[index] = cache->solve(chunk.puzzles[index], chunk.solutions[index],
+                                                                   (corpusFlags & CorpusHasGrades) ? &chunk.grades[index] : nullptr);
+                    else if (!chunk.puzzles[index].checkForDuplicates())
+                        BoardGrader::grade(chunk.puzzles[index], chunk.grades[index]);
+                });
+        },
+        [&](PuzzleChunk &chunk)
+        {
+            for (size_t index = 0; index < chunk.puzzles.size(); index++)
+                writer.append(chunk.puzzles[index], (chunk.solutionCounts[index] == 1) ? &chunk.solutions[index] : nullptr,
+                              &chunk.grades[index]);
+        });
+    if (result == PuzzleTextParser::Error)
+        std::cerr << (inputPath.empty() ? std::string("-") : inputPath) << ":" << parser.lineNumber() << ": " << parser.errorMessage() << std::endl;
+    try {
+        writer.close();
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return (result == PuzzleTextParser::Error) ? 1 : 0;
+}
+
+int BatchSolver::fromCorpus(std::ostream &out) const
+{
+    // write out each puzzle of a corpus, as 81-character lines followed by the solution (if it has one),
+    // or in the saves/ format
+    PuzzleTextWriter writer(out);
+    char line[81 * 2 + 1];
+    for (size_t index = 0; index < corpusInput.size(); index++)
+    {
+        PuzzleRecordView record(corpusInput.record(index));
+        if (outputFormat == SavesFormat)
+        {
+            BoardState state;
+            record.puzzle(state);
+            writer.writeBoardSaves(state);
+            continue;
+        }
+        record.puzzleText(line);
+        size_t length = 81;
+        if (record.solutionText(line + 82))
+        {
+            line[81] = ' ';
+            length = 81 * 2 + 1;
+        }
+        writer.writeLine(line, length);
+    }
+    return 0;
+}
+
+int BatchSolver::enumerate(std::istream &in, std::ostream &out) const
+{
+    // enumerate the solutions of the first puzzle in the input, streaming them to the output as they are found
+    std::string block;
+    uint64_t inputRead = 0;
+    PuzzleTextParser parser;
+    BoardState state;
+    PuzzleTextParser::Result result = PuzzleTextParser::End;
+    while (result == PuzzleTextParser::End && readBlock(in, inputRead, block))
+    {
+        parser.setText(block.data(), block.size());
+        result = parser.next(state);
+    }
+    if (result != PuzzleTextParser::Parsed)
+    {
+        std::cerr << "No valid puzzle in input";
+        if (result == PuzzleTextParser::Error)
+            std::cerr << " (line " << parser.lineNumber() << ": " << parser.errorMessage() << ")";
+        std::cerr << std::endl;
+        return 1;
+    }
+
+    SearchCursor cursor;
+    if (!cursorPath.empty())
+    {
+        std::ifstream cursorFile(cursorPath);
+        std::string cursorString;
+        if (cursorFile)
+            std::getline(cursorFile, cursorString);
+        if (!cursor.fromString(cursorString))
+        {
+            std::cerr << cursorPath << ": bad cursor" << std::endl;
+            return 1;
+        }
+    }
+
+    long long count;
+    PuzzleTextWriter writer(out);
+    try {
+        count = BoardSearch::enumerateSolutions(state, [&](const BoardState &solution)
+        {
+            writeBoard(writer, solution, outputFormat);
+            return bool(out);
+        }, maxCount, cursor, threadCount);
+    } catch (const std::exception &e) {
+        std::cerr << (cursorPath.empty() ? std::string() : cursorPath + ": ") << e.what() << std::endl;
+        return 1;
+    }
+
+    writer.flush();
+    std::cerr << count << " solutions" << (cursor.isFinished() ? " (all found)" : "") << std::endl;
+    if (!cursorPath.empty())
+    {
+        // write the cursor to a new file and then rename it over the old one
+        // so an interrupted write never loses the old cursor
+        std::string tempPath(cursorPath + ".tmp");
+        std::ofstream cursorFile(tempPath);
+        cursorFile << cursor.toString() << '\n';
+        cursorFile.close();
+        if (!cursorFile || std::rename(tempPath.c_str(), cursorPath.c_str()) != 0)
+        {
+            std::cerr << cursorPath << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int BatchSolver::generate(std::ostream &out) const
+{
+    // write out `generateCount` new puzzles, each as 81 characters, a space and its difficulty
+    long long made = PuzzleGenerator::generateMany(generateCount, difficulty, threadCount, seed,
+        [&out](const PuzzleGenerator::Puzzle &puzzle)
+        {
+            std::string line(81, '0');
+            for (int cell = 0; cell < 81; cell++)
+                line[cell] = char('0' + puzzle.puzzle.nums[cell]);
+            out << line << ' ' << puzzle.grade.hardestPass << '\n';
+            return bool(out);
+        });
+    return (made == generateCount) ? 0 : 1;
+}
+
+static SolverServer *runningServer = nullptr;
+
+static void stopRunningServer(int)
+{
+    if (runningServer != nullptr)
+        runningServer->stop();
+}
+
+int BatchSolver::serve()
+{
+    // run as a service until interrupted or terminated
+    SolverServer server(*cache, threadCount, queueLimit);
+    try {
+        server.listen(socketPath);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    runningServer = &server;
+    std::signal(SIGINT, stopRunningServer);
+    std::signal(SIGTERM, stopRunningServer);
+    server.run();
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    runningServer = nullptr;
+    return 0;
+}
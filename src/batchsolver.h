@@ -0,0 +1,128 @@
+#ifndef BATCHSOLVER_H
+#define BATCHSOLVER_H
+
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boardgrader.h"
+#include "boardstate.h"
+#include "puzzlecorpus.h"
+#include "puzzletext.h"
+#include "solutioncache.h"
+#include "workerpool.h"
+
+struct TechniqueStats;
+
+////////// CLASS BatchSolver //////////
+// runs the solver over a file of puzzles from the command line, without any GUI
+// puzzles are one per line, as 81 characters with "0" or "." for an empty cell
+class BatchSolver
+{
+public:
+    BatchSolver();
+
+    static bool isBatchOption(const char *arg);
+    int run(int argc, char *argv[]);
+
+private:
+    enum Mode { NoMode, CheckUnique, Enumerate, Generate, Grade, Dedupe, Solve, ToCorpus, FromCorpus, Serve, Validate };
+    enum OutputFormat { TextFormat, PackedFormat, SavesFormat };
+
+    Mode mode;
+    int threadCount;
+    std::string inputPath, outputPath;
+    long long maxCount;
+    std::string cursorPath;
+    OutputFormat outputFormat;
+    long long generateCount;
+    int difficulty;
+    uint64_t seed;
+    std::string cachePath;
+    size_t cacheSize;
+    std::unique_ptr<SolutionCache> cache;
+    uint32_t corpusFlags;
+    PuzzleCorpusReader corpusInput;
+    std::string socketPath;
+    size_t queueLimit;
+    std::string checkpointPath;
+    bool adaptive;
+    size_t chunkSize;
+    size_t queueDepth;
+    bool pipelineStats;
+    std::unique_ptr<WorkerPool> workers;
+
+    struct Line
+    {
+        // a line of the input, where it lies in the block read
+        const char *text;
+        size_t length;
+    };
+    typedef std::function<std::string(const Line &line, int worker)> LineProcessor;
+
+    struct Chunk
+    {
+        // a block of the input on its way through the stages of `processLines()`, `validate()` or `dedupe()`,
+        // from the reader to the workers to the writer
+        std::string block;
+        std::vector<Line> lines;
+        std::vector<std::string> results;
+        std::vector<long long> counts;      // the counts once the workers were done with this block
+        uint64_t inputEnd;                  // how far into the input the block ends (bytes, or records of a corpus)
+    };
+
+    struct PuzzleChunk
+    {
+        // a block of puzzles on its way through the stages of `toCorpus()`, parsed by the reader,
+        // solved and graded by the workers and appended to the corpus by the writer
+        std::vector<BoardState> puzzles, solutions;
+        std::vector<BoardGrader::Grade> grades;
+        std::vector<int> solutionCounts;
+    };
+
+    struct Checkpoint
+    {
+        // how far a run of `processLines()` has got, so that it can be resumed after being stopped:
+        // the input done (bytes, or records of a corpus) and the length of the output written for it,
+        // with counts kept over the whole run (of the tiers, when grading)
+        // `mode` and `inputSize` tell a checkpoint of another run
+        int mode;
+        uint64_t inputSize, inputDone, outputDone;
+        std::vector<long long> counts;
+
+        Checkpoint() { mode = NoMode; inputSize = inputDone = outputDone = 0; }
+        std::string toString() const;
+        bool fromString(const std::string &str);
+    };
+    Checkpoint checkpoint;
+
+    bool parseArguments(int argc, char *argv[]);
+    void usage() const;
+    static bool parsePuzzleLine(const Line &line, BoardState &state);
+    static void writeBoard(PuzzleTextWriter &writer, const BoardState &state, OutputFormat format);
+    bool readBlock(std::istream &in, uint64_t &inputRead, std::string &block) const;
+    bool readChunk(std::istream &in, uint64_t &inputRead, Chunk &chunk) const;
+    void processLines(std::istream &in, std::ostream &out, const LineProcessor &processLine,
+                      std::atomic<long long> counts[] = nullptr, size_t countSize = 0) const;
+    bool resumeCheckpoint(std::ifstream &inputFile);
+    bool saveCheckpoint(const Checkpoint &progress) const;
+    static bool sizedLineResult(const Line &line, bool withSolution, std::string &result);
+    std::string checkUniqueLine(const Line &line) const;
+    std::string solveLine(const Line &line) const;
+    std::string gradeLine(const Line &line, TechniqueStats *techniqueStats, std::atomic<long long> tierCounts[]) const;
+    int grade(std::istream &in, std::ostream &out) const;
+    static bool parseGridLine(const Line &line, uint8_t puzzle[81], uint8_t grid[81]);
+    int validate(std::istream &in, std::ostream &out) const;
+    int dedupe(std::istream &in, std::ostream &out) const;
+    int enumerate(std::istream &in, std::ostream &out) const;
+    int generate(std::ostream &out) const;
+    int toCorpus(std::istream &in) const;
+    int fromCorpus(std::ostream &out) const;
+    int serve();
+};
+
+#endif // BATCHSOLVER_H
@@ -0,0 +1,85 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+////////// Bit helpers //////////
+
+inline int bitCount64(uint64_t bits)
+{
+#ifdef _MSC_VER
+    return int(__popcnt64(bits));
+#else
+    return __builtin_popcountll(bits);
+#endif
+}
+
+inline int lowestBit64(uint64_t bits)
+{
+    // index of lowest set bit, `bits` must not be 0
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return int(index);
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+
+////////// STRUCT Bitboard81 //////////
+// a set of cells of the 9x9 board, one bit per cell where cell = row * 9 + col
+// cells 0..63 are held in `lo`, cells 64..80 in `hi`
+struct Bitboard81
+{
+    uint64_t lo, hi;
+
+    Bitboard81() { lo = hi = 0; }
+    Bitboard81(uint64_t lo, uint64_t hi)
+    {
+        this->lo = lo;
+        this->hi = hi;
+    }
+    static Bitboard81 all() { return Bitboard81(~uint64_t(0), (uint64_t(1) << 17) - 1); }
+    static Bitboard81 cell(int cell) { Bitboard81 b; b.set(cell); return b; }
+
+    bool test(int cell) const { return (cell < 64) ? ((lo >> cell) & 1) != 0 : ((hi >> (cell - 64)) & 1) != 0; }
+    void set(int cell) { if (cell < 64) lo |= uint64_t(1) << cell; else hi |= uint64_t(1) << (cell - 64); }
+    void clear(int cell) { if (cell < 64) lo &= ~(uint64_t(1) << cell); else hi &= ~(uint64_t(1) << (cell - 64)); }
+    bool isEmpty() const { return (lo | hi) == 0; }
+    int count() const { return bitCount64(lo) + bitCount64(hi); }
+    int first() const
+    {
+        // return lowest cell in the set, or -1 if it is empty
+        if (lo != 0)
+            return lowestBit64(lo);
+        if (hi != 0)
+            return 64 + lowestBit64(hi);
+        return -1;
+    }
+    int takeFirst()
+    {
+        // remove and return lowest cell in the set, or -1 if it is empty
+        int cell = first();
+        if (lo != 0)
+            lo &= lo - 1;
+        else if (hi != 0)
+            hi &= hi - 1;
+        return cell;
+    }
+
+    Bitboard81 operator&(const Bitboard81 &other) const { return Bitboard81(lo & other.lo, hi & other.hi); }
+    Bitboard81 operator|(const Bitboard81 &other) const { return Bitboard81(lo | other.lo, hi | other.hi); }
+    Bitboard81 operator^(const Bitboard81 &other) const { return Bitboard81(lo ^ other.lo, hi ^ other.hi); }
+    Bitboard81 operator~() const { return Bitboard81(~lo, ~hi) & all(); }
+    Bitboard81 &operator&=(const Bitboard81 &other) { lo &= other.lo; hi &= other.hi; return *this; }
+    Bitboard81 &operator|=(const Bitboard81 &other) { lo |= other.lo; hi |= other.hi; return *this; }
+    bool operator==(const Bitboard81 &other) const { return lo == other.lo && hi == other.hi; }
+    bool operator!=(const Bitboard81 &other) const { return !(*this == other); }
+};
+
+#endif // BITBOARD_H
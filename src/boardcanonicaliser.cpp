@@ -0,0 +1,378 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include "boardcanonicaliser.h"
+
+
+////////// CLASS BoardCanonicaliser //////////
+
+// candidates beyond which those with the same future are merged
+// (a board with many numbers rarely has more than a few tied, so they go without the cost of looking)
+static const size_t maxCandidatesKept = 64;
+
+BoardCanonicaliser::BoardCanonicaliser()
+{
+}
+
+/*static*/ const std::vector<uint8_t> &BoardCanonicaliser::columnOrders()
+{
+    // the 6 * 6 * 6 * 6 = 1296 orders of the columns allowed by permuting the stacks and the columns within each stack
+    // 9 entries per order
+    static const std::vector<uint8_t> orders = []()
+    {
+        static const uint8_t perms[6][3] = { {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0} };
+        std::vector<uint8_t> orders;
+        orders.reserve(1296 * 9);
+        for (const uint8_t *stacks : perms)
+            for (const uint8_t *cols0 : perms)
+                for (const uint8_t *cols1 : perms)
+                    for (const uint8_t *cols2 : perms)
+                    {
+                        const uint8_t *cols[3] = { cols0, cols1, cols2 };
+                        for (int i = 0; i < 3; i++)
+                            for (int j = 0; j < 3; j++)
+                                orders.push_back(uint8_t(stacks[i] * 3 + cols[i][j]));
+                    }
+        return orders;
+    }();
+    return orders;
+}
+
+void BoardCanonicaliser::Transform::apply(const BoardState &board, BoardState &canonical) const
+{
+    // (`canonical` must not be `board`)
+    for (int row = 0; row < 9; row++)
+        for (int col = 0; col < 9; col++)
+        {
+            int cell = transposed ? cols[col] * 9 + rows[row] : rows[row] * 9 + cols[col];
+            canonical.nums[row * 9 + col] = labels[board.nums[cell]];
+        }
+    canonical.resetAllPossibilities();
+}
+
+void BoardCanonicaliser::Transform::unapply(const BoardState &canonical, BoardState &board) const
+{
+    // (`board` must not be `canonical`)
+    uint8_t nums[10];
+    for (int num = 0; num <= 9; num++)
+        nums[labels[num]] = uint8_t(num);
+    for (int row = 0; row < 9; row++)
+        for (int col = 0; col < 9; col++)
+        {
+            int cell = transposed ? cols[col] * 9 + rows[row] : rows[row] * 9 + cols[col];
+            board.nums[cell] = nums[canonical.nums[row * 9 + col]];
+        }
+    board.resetAllPossibilities();
+}
+
+void BoardCanonicaliser::canonicalise(const BoardState &state, BoardState &canonical, Transform *transform /*= nullptr*/)
+{
+    // (copied, so that `canonical` may be `state`)
+    uint8_t grids[2][81];
+    for (int row = 0; row < 9; row++)
+        for (int col = 0; col < 9; col++)
+            grids[0][row * 9 + col] = grids[1][col * 9 + row] = state.nums[row * 9 + col];
+
+    // the first row: its numbers are all different, so relabelled it depends only on which of its cells are empty
+    // and it is least with the stacks in order of most empty cells and the empty cells first within each stack
+    // so find the best pattern of empty cells any row can have, and start from each row and column order giving it
+    // (a pattern has bit 8 - i set if cell i of the row is empty)
+    int rowPatterns[2][9], bestPattern = -1;
+    for (int grid = 0; grid < 2; grid++)
+        for (int row = 0; row < 9; row++)
+        {
+            int emptyCounts[3] = { 0, 0, 0 };
+            for (int col = 0; col < 9; col++)
+                if (grids[grid][row * 9 + col] == 0)
+                    emptyCounts[col / 3]++;
+            std::sort(emptyCounts, emptyCounts + 3, std::greater<int>());
+            int pattern = 0;
+            for (int stack = 0; stack < 3; stack++)
+                pattern |= ((7 << (3 - emptyCounts[stack])) & 7) << ((2 - stack) * 3);
+            rowPatterns[grid][row] = pattern;
+            bestPattern = std::max(bestPattern, pattern);
+        }
+
+    canonical.clear();
+    firstTwoRows(grids, rowPatterns, bestPattern, canonical);
+    if (candidates.size() > maxCandidatesKept)
+        dropEquivalentCandidates(grids[0], 2);
+    for (int depth = 2; depth < 9; depth++)
+    {
+        // try every row allowed next for every candidate, and keep just those giving the least row
+        // the first row of a band can come from any band not yet used, the others from the same band
+        uint8_t *bestRow = &canonical.nums[depth * 9];
+        bool haveBest = false;
+        nextCandidates.clear();
+        for (const Candidate &candidate : candidates)
+            for (int row = 0; row < 9; row++)
+            {
+                if ((candidate.usedRows & (1 << row)) != 0)
+                    continue;
+                if ((depth % 3 == 0) ? (candidate.usedRows & (7 << (row / 3 * 3))) != 0 : row / 3 != candidate.band)
+                    continue;
+                const uint8_t *rowNums = &candidate.grid[row * 9];
+                uint8_t labels[10], newRow[9];
+                std::memcpy(labels, candidate.labels, sizeof(labels));
+                int nextLabel = candidate.nextLabel;
+                bool less = !haveBest, greater = false;
+                for (int i = 0; i < 9 && !greater; i++)
+                {
+                    int num = rowNums[candidate.cols[i]];
+                    if (num != 0)
+                    {
+                        if (labels[num] == 0)
+                            labels[num] = uint8_t(nextLabel++);
+                        num = labels[num];
+                    }
+                    newRow[i] = uint8_t(num);
+                    if (!less)
+                    {
+                        if (num < bestRow[i])
+                            less = true;
+                        else if (num > bestRow[i])
+                            greater = true;
+                    }
+                }
+                if (greater)
+                    continue;
+                if (less)
+                {
+                    std::memcpy(bestRow, newRow, 9);
+                    haveBest = true;
+                    nextCandidates.clear();
+                }
+                Candidate next(candidate);
+                next.usedRows |= uint16_t(1 << row);
+                next.rows[depth] = uint8_t(row);
+                next.band = int8_t(row / 3);
+                next.nextLabel = uint8_t(nextLabel);
+                std::memcpy(next.labels, labels, sizeof(labels));
+                nextCandidates.push_back(next);
+            }
+        candidates.swap(nextCandidates);
+        if (candidates.size() > maxCandidatesKept)
+            dropEquivalentCandidates(grids[0], depth + 1);
+    }
+    canonical.resetAllPossibilities();
+
+    if (transform != nullptr)
+    {
+        // any of the candidates left will do, as they all give the canonical form
+        // numbers not on the board are given the labels left over, in order
+        const Candidate &candidate(candidates.front());
+        transform->transposed = (candidate.grid == grids[1]);
+        std::memcpy(transform->rows, candidate.rows, 9);
+        std::memcpy(transform->cols, candidate.cols, 9);
+        std::memcpy(transform->labels, candidate.labels, 10);
+        int nextLabel = candidate.nextLabel;
+        for (int num = 1; num <= 9; num++)
+            if (transform->labels[num] == 0)
+                transform->labels[num] = uint8_t(nextLabel++);
+    }
+}
+
+void BoardCanonicaliser::firstTwoRows(const uint8_t grids[2][81], const int rowPatterns[2][9], int bestPattern, BoardState &canonical)
+{
+    // the candidates for the first two rows, putting those two rows into `canonical`
+    // the first row's numbers are all different, so relabelled it is just `bestPattern` with the labels in order,
+    // and for each first row giving that and each row which can come second, the column orders giving the least
+    // second row are searched for a position at a time (see `searchSecondRow()`) rather than trying all 1296
+    OrderSearch search;
+    int firstNextLabel = 1;
+    for (int i = 0; i < 9; i++)
+        search.positionLabels[i] = uint8_t((bestPattern & (1 << (8 - i))) ? 0 : firstNextLabel++);
+    for (int stackPosition = 0; stackPosition < 3; stackPosition++)
+        search.positionEmpties[stackPosition] = uint8_t(std::count(&search.positionLabels[stackPosition * 3], &search.positionLabels[stackPosition * 3 + 3], 0));
+    std::memcpy(&canonical.nums[0], search.positionLabels, 9);
+    uint8_t *bestRow = &canonical.nums[9];
+    std::fill(bestRow, bestRow + 9, uint8_t(255));
+    candidates.clear();
+    for (int grid = 0; grid < 2; grid++)
+        for (int row = 0; row < 9; row++)
+        {
+            if (rowPatterns[grid][row] != bestPattern)
+                continue;
+            search.grid = grids[grid];
+            search.firstRow = uint8_t(row);
+            std::fill(search.firstRowCols, search.firstRowCols + 10, int8_t(-1));
+            std::fill(search.stackEmpties, search.stackEmpties + 3, uint8_t(0));
+            for (int col = 0; col < 9; col++)
+            {
+                int num = grids[grid][row * 9 + col];
+                if (num != 0)
+                    search.firstRowCols[num] = int8_t(col);
+                else
+                    search.stackEmpties[col / 3]++;
+            }
+            std::fill(search.cols, search.cols + 9, int8_t(-1));
+            std::fill(search.positions, search.positions + 9, int8_t(-1));
+            std::fill(search.stacks, search.stacks + 3, int8_t(-1));
+            std::fill(search.stackPositions, search.stackPositions + 3, int8_t(-1));
+            std::fill(search.labels, search.labels + 10, uint8_t(0));
+            search.nextLabel = uint8_t(firstNextLabel);
+            for (int secondRow = row / 3 * 3; secondRow < row / 3 * 3 + 3; secondRow++)
+                if (secondRow != row)
+                {
+                    search.secondRow = uint8_t(secondRow);
+                    searchSecondRow(search, 0, bestRow);
+                }
+        }
+}
+
+void BoardCanonicaliser::OrderSearch::place(int col, int position)
+{
+    cols[position] = int8_t(col);
+    positions[col] = int8_t(position);
+    if (stacks[position / 3] < 0)
+    {
+        stacks[position / 3] = int8_t(col / 3);
+        stackPositions[col / 3] = int8_t(position / 3);
+    }
+}
+
+void BoardCanonicaliser::searchSecondRow(const OrderSearch &search, int position, uint8_t *bestRow)
+{
+    // extend the column order in `search` at `position`, keeping to those giving no more than `bestRow`
+    // each column which can go next gives the second row's next cell, and when the number there is in the first row
+    // its label comes from the position of its column there: if that column has no position yet, it is put at
+    // the first one it can go, as any order giving the least second row must put it there
+    // so the search only branches over columns giving the same cell
+    // (a `bestRow` cell of 255 is not found yet)
+    if (position == 9)
+    {
+        // an order giving the least second row so far: find it in `columnOrders()`
+        // (an order is numbered by the permutations of the stacks and of the columns within each, as they are made there)
+        auto permutation = [](int a, int b, int c) { return a * 2 + (b > c ? 1 : 0); };
+        int order = permutation(search.stacks[0], search.stacks[1], search.stacks[2]);
+        for (int stackPosition = 0; stackPosition < 3; stackPosition++)
+        {
+            const int8_t *cols = &search.cols[stackPosition * 3];
+            int first = search.stacks[stackPosition] * 3;
+            order = order * 6 + permutation(cols[0] - first, cols[1] - first, cols[2] - first);
+        }
+        Candidate candidate;
+        candidate.grid = search.grid;
+        candidate.cols = &columnOrders()[size_t(order) * 9];
+        candidate.usedRows = uint16_t((1 << search.firstRow) | (1 << search.secondRow));
+        candidate.rows[0] = search.firstRow;
+        candidate.rows[1] = search.secondRow;
+        candidate.band = int8_t(search.firstRow / 3);
+        candidate.nextLabel = search.nextLabel;
+        candidate.labels[0] = 0;
+        for (int num = 1; num <= 9; num++)
+            candidate.labels[num] = (search.firstRowCols[num] >= 0) ? search.positionLabels[search.positions[search.firstRowCols[num]]] : search.labels[num];
+        candidates.push_back(candidate);
+        return;
+    }
+
+    const uint8_t *firstNums = &search.grid[search.firstRow * 9], *secondNums = &search.grid[search.secondRow * 9];
+    int stackPosition = position / 3;
+    // the column put here already, or else one with no position yet from the stack at this stack position
+    // (or from a stack with no position yet, with as many empty cells in the first row), empty there just if this is
+    int firstCol = 0, endCol = 9;
+    if (search.cols[position] >= 0)
+        firstCol = search.cols[position], endCol = firstCol + 1;
+    else if (search.stacks[stackPosition] >= 0)
+        firstCol = search.stacks[stackPosition] * 3, endCol = firstCol + 3;
+    for (int col = firstCol; col < endCol; col++)
+    {
+        if (search.cols[position] < 0
+                && (search.positions[col] >= 0
+                    || (search.stacks[stackPosition] < 0
+                        && (search.stackPositions[col / 3] >= 0 || search.stackEmpties[col / 3] != search.positionEmpties[stackPosition]))
+                    || (firstNums[col] == 0) != (search.positionLabels[position] == 0)))
+            continue;
+
+        OrderSearch next(search);
+        if (next.cols[position] < 0)
+            next.place(col, position);
+        int num = secondNums[col];
+        if (num != 0)
+        {
+            int numCol = next.firstRowCols[num];
+            if (numCol < 0)
+            {
+                if (next.labels[num] == 0)
+                    next.labels[num] = next.nextLabel++;
+                num = next.labels[num];
+            }
+            else
+            {
+                if (next.positions[numCol] < 0)
+                {
+                    int numStackPosition = next.stackPositions[numCol / 3];
+                    if (numStackPosition < 0)
+                    {
+                        numStackPosition = stackPosition + 1;
+                        while (next.stacks[numStackPosition] >= 0 || next.positionEmpties[numStackPosition] != next.stackEmpties[numCol / 3])
+                            numStackPosition++;
+                    }
+                    int numPosition = numStackPosition * 3;
+                    while (next.cols[numPosition] >= 0 || next.positionLabels[numPosition] == 0)
+                        numPosition++;
+                    next.place(numCol, numPosition);
+                }
+                num = next.positionLabels[next.positions[numCol]];
+            }
+        }
+        if (num > bestRow[position])
+            continue;
+        if (num < bestRow[position])
+        {
+            bestRow[position] = uint8_t(num);
+            std::fill(bestRow + position + 1, bestRow + 9, uint8_t(255));
+            candidates.clear();
+        }
+        searchSecondRow(next, position + 1, bestRow);
+    }
+}
+
+void BoardCanonicaliser::dropEquivalentCandidates(const uint8_t *board, int depth)
+{
+    // with `depth` rows placed, keep just one of each set of candidates which would give the same rows from here on whatever:
+    // those from the same grid (the board or its transpose), with the same rows left to place, the same labels,
+    // and the same numbers in those rows read in their column orders
+    // on a board with few numbers almost every transformation stays tied, and without this the empty board
+    // would keep 2 * 9 * 1296 * 2 candidates at the second row and multiply them at every row after
+    size_t keySize = 13 + size_t(9 - depth) * 9;
+    candidateKeys.resize(candidates.size() * keySize);
+    candidateOrder.resize(candidates.size());
+    for (size_t index = 0; index < candidates.size(); index++)
+    {
+        const Candidate &candidate(candidates[index]);
+        uint8_t *key = &candidateKeys[index * keySize];
+        *key++ = uint8_t(candidate.grid != board);
+        *key++ = uint8_t(candidate.usedRows);
+        *key++ = uint8_t(candidate.usedRows >> 8);
+        std::memcpy(key, candidate.labels, 10);
+        key += 10;
+        for (int row = 0; row < 9; row++)
+            if ((candidate.usedRows & (1 << row)) == 0)
+                for (int i = 0; i < 9; i++)
+                    *key++ = candidate.grid[row * 9 + candidate.cols[i]];
+        candidateOrder[index] = uint32_t(index);
+    }
+    std::sort(candidateOrder.begin(), candidateOrder.end(), [&](uint32_t a, uint32_t b)
+    {
+        int compared = std::memcmp(&candidateKeys[a * keySize], &candidateKeys[b * keySize], keySize);
+        return (compared != 0) ? compared < 0 : a < b;
+    });
+    nextCandidates.clear();
+    for (size_t i = 0; i < candidateOrder.size(); i++)
+        if (i == 0 || std::memcmp(&candidateKeys[candidateOrder[i - 1] * keySize], &candidateKeys[candidateOrder[i] * keySize], keySize) != 0)
+            nextCandidates.push_back(candidates[candidateOrder[i]]);
+    candidates.swap(nextCandidates);
+}
+
+std::string BoardCanonicaliser::canonicalString(const BoardState &state)
+{
+    // the canonical form as 81 characters, "0" for an empty cell
+    BoardState canonical;
+    canonicalise(state, canonical);
+    std::string str(81, '0');
+    for (int cell = 0; cell < 81; cell++)
+        str[cell] = char('0' + canonical.nums[cell]);
+    return str;
+}
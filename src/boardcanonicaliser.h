@@ -0,0 +1,78 @@
+#ifndef BOARDCANONICALISER_H
+#define BOARDCANONICALISER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "boardstate.h"
+
+////////// CLASS BoardCanonicaliser //////////
+// maps a board to a canonical form which is the same for every board equivalent to it under
+// relabelling the numbers, permuting the bands, the rows within a band, the stacks and the columns within a stack,
+// and transposing: of all those boards, the canonical form is the least when read cell by cell (with 0 for empty)
+// it builds the canonical form a row at a time, keeping only the transformations which give the least rows so far,
+// searching for the column orders with the second row and merging transformations which can only go on alike
+// (about 20000 full grids a second on one core, and tens of milliseconds at worst for a nearly empty board)
+class BoardCanonicaliser
+{
+public:
+    struct Transform
+    {
+        // how a board maps to its canonical form
+        bool transposed;
+        uint8_t rows[9], cols[9];   // [canonical row/col] -> row/col of the board (after transposing)
+        uint8_t labels[10];         // [num of the board] -> num of the canonical form
+
+        void apply(const BoardState &board, BoardState &canonical) const;
+        void unapply(const BoardState &canonical, BoardState &board) const;
+    };
+
+    BoardCanonicaliser();
+
+    void canonicalise(const BoardState &state, BoardState &canonical, Transform *transform = nullptr);
+    std::string canonicalString(const BoardState &state);
+
+private:
+    struct Candidate
+    {
+        const uint8_t *grid;    // the board or its transpose
+        const uint8_t *cols;    // column order
+        uint16_t usedRows;
+        uint8_t rows[9];        // rows placed so far
+        int8_t band;            // band of the row last placed
+        uint8_t nextLabel;
+        uint8_t labels[10];     // [num] -> its number in the canonical form, or 0 if not seen yet
+    };
+
+    struct OrderSearch
+    {
+        // a column order being found a position at a time, for a first and second row
+        const uint8_t *grid;
+        uint8_t firstRow, secondRow;
+        uint8_t positionLabels[9];  // [position] -> label of the first row's number there, or 0 if it is empty
+        uint8_t positionEmpties[3]; // [stack position] -> empty cells of the first row there
+        int8_t firstRowCols[10];    // [num] -> column of the first row it is in, or -1
+        uint8_t stackEmpties[3];    // [stack] -> empty cells of the first row in it
+        int8_t cols[9];             // [position] -> column, or -1 if not placed yet
+        int8_t positions[9];        // [column] -> position, or -1 if not placed yet
+        int8_t stacks[3];           // [stack position] -> stack, or -1 if not placed yet
+        int8_t stackPositions[3];   // [stack] -> stack position, or -1 if not placed yet
+        uint8_t labels[10];         // [num] -> label of a number not in the first row, or 0 if not seen yet
+        uint8_t nextLabel;
+
+        void place(int col, int position);
+    };
+
+    static const std::vector<uint8_t> &columnOrders();
+    void firstTwoRows(const uint8_t grids[2][81], const int rowPatterns[2][9], int bestPattern, BoardState &canonical);
+    void searchSecondRow(const OrderSearch &search, int position, uint8_t *bestRow);
+    void dropEquivalentCandidates(const uint8_t *board, int depth);
+
+    // kept between calls so that canonicalising many boards does not allocate each time
+    std::vector<Candidate> candidates, nextCandidates;
+    std::vector<uint8_t> candidateKeys;
+    std::vector<uint32_t> candidateOrder;
+};
+
+#endif // BOARDCANONICALISER_H
@@ -0,0 +1,83 @@
+#include <algorithm>
+
+#include "boardgrader.h"
+#include "boardsearch.h"
+#include "boardsolver.h"
+#include "solverpipeline.h"
+
+
+////////// CLASS BoardGrader //////////
+
+BoardGrader::Tier BoardGrader::Grade::tier() const
+{
+    // one tier per hardest pass (a puzzle with nothing to solve counts as easy)
+    return Tier(std::max(hardestPass, 1) - 1);
+}
+
+/*static*/ void BoardGrader::grade(const BoardState &puzzle, Grade &grade, TechniqueStats *adaptiveStats /*= nullptr*/)
+{
+    // solve a puzzle by steps, counting the steps each pass found
+    // the rating orders puzzles by tier first, then by the steps needed, the harder passes' steps weighing more
+    // with `adaptiveStats` the solver orders its techniques by (and adds to) those stats, which is quicker over many puzzles
+    // but may find different steps first, so the counts can differ a little from those of the usual order
+    // a puzzle the passes solve has just the one solution, as every step was certain, but where they get stuck
+    // it may have none or more than one, which a search then tells (such a puzzle has no tier worth the name)
+    static const int passWeights[NeedsSearch + 1] = { 0, 1, 2, 5, 20, 50, 0 };
+    BoardSolver solver;
+    if (adaptiveStats != nullptr)
+        solver.setAdaptiveOrdering(true, adaptiveStats);
+    solver.state = puzzle;
+    solver.resetAllPossibilities();
+    solver.reduceAllPossibilities();
+    grade.hardestPass = 0;
+    grade.solutionCount = 1;
+    std::fill(grade.stepCounts, grade.stepCounts + PassCount + 1, 0);
+    int weightedSteps = 0;
+    CellNum wave[81];
+    while (!solver.state.isSolved())
+    {
+        // all the naked singles there are go in together as a wave, which comes to the same as placing them one at a time
+        // (any placed by one pass 1 step would still be singles for the next), in far fewer rounds
+        // unless the wave runs into a contradiction, when they are taken back and found one at a time after all
+        BoardState beforeWave(solver.state);
+        int waveCount = solver.solveFindWave(wave, false);
+        if (waveCount > 0)
+        {
+            if (solver.applyWave(wave, waveCount))
+            {
+                grade.stepCounts[1] += waveCount;
+                weightedSteps += passWeights[1] * waveCount;
+                grade.hardestPass = std::max(grade.hardestPass, 1);
+                continue;
+            }
+            solver.state = beforeWave;
+        }
+
+        // (the usual order is the full pipeline, inlined)
+        CellNum cellNum = (adaptiveStats != nullptr) ? solver.solveFindStep() : FullPipeline::findStep(solver);
+        if (cellNum.isEmpty())
+        {
+            grade.hardestPass = NeedsSearch;
+            grade.solutionCount = BoardSearch::countSolutions(puzzle, 2);
+            break;
+        }
+        int pass = solver.lastStepPass();
+        grade.stepCounts[pass]++;
+        weightedSteps += passWeights[pass];
+        grade.hardestPass = std::max(grade.hardestPass, pass);
+        solver.placeNum(cellNum.row, cellNum.col, cellNum.num);
+    }
+    grade.rating = grade.tier() * 10000 + weightedSteps;
+}
+
+/*static*/ const char *BoardGrader::tierName(Tier tier)
+{
+    static const char *const tierNames[TierCount] = { "easy", "moderate", "tough", "hard", "fiendish", "diabolical" };
+    return (tier >= 0 && tier < TierCount) ? tierNames[tier] : "";
+}
+
+/*static*/ const char *BoardGrader::solutionCountName(int solutionCount)
+{
+    // what is shown in place of the tier for a puzzle without just one solution
+    return (solutionCount == 0) ? "invalid" : (solutionCount == 1) ? "" : "not-unique";
+}
@@ -0,0 +1,33 @@
+#ifndef BOARDGRADER_H
+#define BOARDGRADER_H
+
+#include "boardstate.h"
+
+struct TechniqueStats;
+
+////////// CLASS BoardGrader //////////
+// grades how hard a puzzle is by solving it by steps with `BoardSolver`
+// and recording which pass of `solveFindStep()` found each step
+class BoardGrader
+{
+public:
+    enum { PassCount = 5, NeedsSearch = PassCount + 1 };
+    enum Tier { Easy, Moderate, Tough, Hard, Fiendish, Diabolical, TierCount };
+
+    struct Grade
+    {
+        int hardestPass;                // 1 to `PassCount`, or `NeedsSearch` if the passes got stuck
+        int stepCounts[PassCount + 1];  // [pass] -> number of steps that pass found
+        int rating;
+        int solutionCount;              // 1, or if the passes got stuck and search found otherwise 0, or 2 for more than one
+
+        Tier tier() const;
+        bool hasOneSolution() const { return solutionCount == 1; }
+    };
+
+    static void grade(const BoardState &puzzle, Grade &grade, TechniqueStats *adaptiveStats = nullptr);
+    static const char *tierName(Tier tier);
+    static const char *solutionCountName(int solutionCount);
+};
+
+#endif // BOARDGRADER_H
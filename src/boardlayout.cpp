@@ -0,0 +1,181 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "boardlayout.h"
+
+
+////////// STRUCT BoardLayout //////////
+
+BoardLayout::BoardLayout()
+{
+    // the standard board
+    for (int cell = 0; cell < 81; cell++)
+        boxes[cell] = uint8_t(cell / 27 * 3 + cell % 9 / 3);
+    extras = 0;
+    compile();
+}
+
+/*static*/ const BoardLayout &BoardLayout::standard()
+{
+    static const BoardLayout layout;
+    return layout;
+}
+
+bool BoardLayout::isStandard() const
+{
+    return extras == 0 && hasRegularBoxes();
+}
+
+bool BoardLayout::hasRegularBoxes() const
+{
+    for (int cell = 0; cell < 81; cell++)
+        if (boxes[cell] != cell / 27 * 3 + cell % 9 / 3)
+            return false;
+    return true;
+}
+
+void BoardLayout::setBoxes(const uint8_t boxes[81])
+{
+    // set the box of each cell, for a jigsaw; throw if any box does not have 9 cells, leaving the layout as it was
+    int counts[9] = {};
+    for (int cell = 0; cell < 81; cell++)
+    {
+        if (boxes[cell] > 8)
+            throw std::runtime_error("Box number out of range");
+        counts[boxes[cell]]++;
+    }
+    for (int count : counts)
+        if (count != 9)
+            throw std::runtime_error("Each box must have 9 cells");
+    std::memcpy(this->boxes, boxes, sizeof(this->boxes));
+    compile();
+}
+
+void BoardLayout::setExtras(uint32_t extras)
+{
+    this->extras = extras & (Diagonals | Windows);
+    compile();
+}
+
+void BoardLayout::compile()
+{
+    // fill in the tables from the boxes and the extras
+    int boxSizes[9] = {};
+    for (int i = 0; i < 9; i++)
+        for (int j = 0; j < 9; j++)
+        {
+            unitCells[i][j] = uint8_t(i * 9 + j);
+            unitCells[9 + i][j] = uint8_t(j * 9 + i);
+        }
+    for (int cell = 0; cell < 81; cell++)
+        unitCells[18 + boxes[cell]][boxSizes[boxes[cell]]++] = uint8_t(cell);
+    unitCount = BaseUnitCount;
+    if ((extras & Diagonals) != 0)
+    {
+        for (int i = 0; i < 9; i++)
+        {
+            unitCells[unitCount][i] = uint8_t(i * 9 + i);
+            unitCells[unitCount + 1][i] = uint8_t(i * 9 + 8 - i);
+        }
+        unitCount += 2;
+    }
+    if ((extras & Windows) != 0)
+    {
+        // the 3x3 windows 1 cell in from each side of the board
+        for (int window = 0; window < 4; window++)
+            for (int i = 0; i < 9; i++)
+                unitCells[unitCount + window][i] = uint8_t((window / 2 * 4 + 1 + i / 3) * 9 + window % 2 * 4 + 1 + i % 3);
+        unitCount += 4;
+    }
+
+    std::memset(cellUnitCounts, 0, sizeof(cellUnitCounts));
+    for (int unit = 0; unit < unitCount; unit++)
+    {
+        unitBoards[unit] = Bitboard81();
+        for (int index = 0; index < 9; index++)
+        {
+            int cell = unitCells[unit][index];
+            unitBoards[unit].set(cell);
+            unitCellSlots[unit][index] = cellUnitCounts[cell];
+            cellUnits[cell][cellUnitCounts[cell]++] = uint8_t(unit);
+        }
+    }
+    for (int cell = 0; cell < 81; cell++)
+    {
+        peerBoards[cell] = Bitboard81();
+        for (int slot = 0; slot < cellUnitCounts[cell]; slot++)
+            peerBoards[cell] |= unitBoards[cellUnits[cell][slot]];
+        peerBoards[cell].clear(cell);
+    }
+}
+
+std::string BoardLayout::toText() const
+{
+    // comment lines to go with a board as text, so that other readers can skip them (nothing for the standard board):
+    // "# layout: diagonals windows" for the extras, "# boxes: " and the box (1-9) of each cell for a jigsaw
+    std::string text;
+    if (extras != 0)
+    {
+        text += "# layout:";
+        if ((extras & Diagonals) != 0)
+            text += " diagonals";
+        if ((extras & Windows) != 0)
+            text += " windows";
+        text += '\n';
+    }
+    if (!hasRegularBoxes())
+    {
+        text += "# boxes: ";
+        for (int cell = 0; cell < 81; cell++)
+            text += char('1' + boxes[cell]);
+        text += '\n';
+    }
+    return text;
+}
+
+bool BoardLayout::parseTextLine(const char *line, size_t length)
+{
+    // take a line as written by `toText()`: return whether it was one, throw if it was but is not right
+    static const char layoutPrefix[] = "# layout:", boxesPrefix[] = "# boxes:";
+    std::string text(line, length);
+    while (!text.empty() && (text.back() == '\r' || text.back() == '\n'))
+        text.pop_back();
+    if (text.compare(0, sizeof(layoutPrefix) - 1, layoutPrefix) == 0)
+    {
+        uint32_t extras = 0;
+        size_t pos = sizeof(layoutPrefix) - 1;
+        while (pos < text.size())
+        {
+            size_t start = text.find_first_not_of(" \t", pos);
+            if (start == std::string::npos)
+                break;
+            pos = text.find_first_of(" \t", start);
+            std::string word(text, start, (pos == std::string::npos) ? std::string::npos : pos - start);
+            if (word == "diagonals")
+                extras |= Diagonals;
+            else if (word == "windows")
+                extras |= Windows;
+            else
+                throw std::runtime_error("Unknown layout \"" + word + "\"");
+        }
+        setExtras(extras);
+        return true;
+    }
+    if (text.compare(0, sizeof(boxesPrefix) - 1, boxesPrefix) == 0)
+    {
+        size_t start = text.find_first_not_of(" \t", sizeof(boxesPrefix) - 1);
+        if (start == std::string::npos || text.size() - start != 81)
+            throw std::runtime_error("Boxes must give the box of each of the 81 cells");
+        uint8_t boxes[81];
+        for (int cell = 0; cell < 81; cell++)
+        {
+            char ch = text[start + cell];
+            if (ch < '1' || ch > '9')
+                throw std::runtime_error("Box number out of range");
+            boxes[cell] = uint8_t(ch - '1');
+        }
+        setBoxes(boxes);
+        return true;
+    }
+    return false;
+}
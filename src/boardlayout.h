@@ -0,0 +1,48 @@
+#ifndef BOARDLAYOUT_H
+#define BOARDLAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "bitboard.h"
+
+////////// STRUCT BoardLayout //////////
+// the units of a board, each 9 cells which must hold the numbers 1 to 9 once each
+// units 0-8 are the rows, 9-17 the columns and 18-26 the boxes (i.e. `CellGroupIteratorDirection` * 9 + param),
+// the boxes being irregular for a jigsaw, then come any extra units of a variant:
+// the 2 long diagonals of X-Sudoku and the 4 windows of Windoku
+// it is all compiled into flat tables of each unit's cells and each cell's units and peers,
+// so that the solver goes through a variant just as it goes through the standard board
+// a `BoardState` points to its layout, which must outlive it and not change under it
+struct BoardLayout
+{
+    enum { BaseUnitCount = 27, MaxUnitCount = BaseUnitCount + 2 + 4, MaxCellUnitCount = 6 };
+    enum Extra { Diagonals = 1, Windows = 2 };
+
+    uint8_t boxes[81];                              // [cell] -> box (0-8)
+    uint32_t extras;                                // `Extra` flags
+    int unitCount;
+    uint8_t unitCells[MaxUnitCount][9];             // [unit] -> cells, in ascending order
+    uint8_t unitCellSlots[MaxUnitCount][9];         // [unit][index] -> where the unit is in `cellUnits` of that cell
+    Bitboard81 unitBoards[MaxUnitCount];
+    uint8_t cellUnitCounts[81];
+    uint8_t cellUnits[81][MaxCellUnitCount];        // [cell] -> units the cell is in, in unit order
+    Bitboard81 peerBoards[81];                      // [cell] -> cells sharing a unit with it
+
+    BoardLayout();
+    static const BoardLayout &standard();
+
+    bool isStandard() const;
+    bool hasRegularBoxes() const;
+    void setBoxes(const uint8_t boxes[81]);
+    void setExtras(uint32_t extras);
+
+    std::string toText() const;
+    bool parseTextLine(const char *line, size_t length);
+
+private:
+    void compile();
+};
+
+#endif // BOARDLAYOUT_H
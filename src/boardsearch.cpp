@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+#include "boardsearch.h"
+
+
+////////// STRUCT SearchCursor //////////
+
+bool SearchCursor::isFinished() const
+{
+    if (!isStarted())
+        return false;
+    for (SubtreeStatus status : subtreeStatus)
+        if (status != Done)
+            return false;
+    return true;
+}
+
+std::string SearchCursor::toString() const
+{
+    // "<splitLevels>:" followed by a comma-separated token per subtree
+    // "-" for still to do, "*" for finished, or the guessed numbers leading to its last solution
+    // (an enumeration which has not started is an empty string)
+    if (!isStarted())
+        return std::string();
+    std::string str(std::to_string(splitLevels) + ":");
+    for (size_t subtree = 0; subtree < subtreeStatus.size(); subtree++)
+    {
+        if (subtree > 0)
+            str += ',';
+        switch (subtreeStatus[subtree])
+        {
+        case Pending: str += '-'; break;
+        case Done: str += '*'; break;
+        case Started:
+            for (uint8_t num : subtreeGuesses[subtree])
+                str += char('0' + num);
+            break;
+        }
+    }
+    return str;
+}
+
+bool SearchCursor::fromString(const std::string &str)
+{
+    *this = SearchCursor();
+    if (str.empty())
+        return true;
+    size_t colon = str.find(':');
+    if (colon == std::string::npos || colon == 0)
+        return false;
+    int levels = 0;
+    for (size_t i = 0; i < colon; i++)
+    {
+        if (str[i] < '0' || str[i] > '9')
+            return false;
+        levels = levels * 10 + (str[i] - '0');
+    }
+    SearchCursor cursor;
+    cursor.splitLevels = levels;
+    size_t start = colon + 1;
+    while (start <= str.size())
+    {
+        size_t end = str.find(',', start);
+        if (end == std::string::npos)
+            end = str.size();
+        std::string token(str, start, end - start);
+        std::vector<uint8_t> guesses;
+        SubtreeStatus status = Started;
+        if (token == "-")
+            status = Pending;
+        else if (token == "*")
+            status = Done;
+        else
+            for (char ch : token)
+            {
+                if (ch < '1' || ch > '9')
+                    return false;
+                guesses.push_back(uint8_t(ch - '0'));
+            }
+        cursor.subtreeStatus.push_back(status);
+        cursor.subtreeGuesses.push_back(guesses);
+        start = end + 1;
+    }
+    *this = cursor;
+    return true;
+}
+
+
+////////// CLASS BoardSearch //////////
+
+/*static*/ bool BoardSearch::prepare(BoardState &state)
+{
+    // get a board ready to be searched: reduce its possibilities and place its singles
+    // return false if it already cannot be solved
+    if (state.checkForDuplicates())
+        return false;
+    state.reduceAllPossibilities();
+    return state.propagateSingles();
+}
+
+/*static*/ int BoardSearch::guessCell(const BoardState &state)
+{
+    // return the empty cell with the fewest possibilities, or -1 if there are no empty cells
+    int bestCell = -1, bestCount = 10;
+    for (int cell = 0; cell < 81; cell++)
+        if (state.nums[cell] == 0)
+        {
+            int count = bitCount64(state.cellPossibilities[cell]);
+            if (count < bestCount)
+            {
+                bestCell = cell;
+                bestCount = count;
+                if (count <= 2)
+                    break;
+            }
+        }
+    return bestCell;
+}
+
+/*static*/ bool BoardSearch::guess(const BoardState &state, int cell, int num, BoardState &result)
+{
+    // place a guessed number on a copy of the board, followed by all the singles that leads to
+    // return false if that leads to a contradiction
+    result = state;
+    result.setNumInCell(cell / 9, cell % 9, num);
+    result.reducePossibilities(cell / 9, cell % 9);
+    return result.propagateSingles();
+}
+
+/*static*/ void BoardSearch::countSolutionsFrom(const BoardState &state, int limit, std::atomic<int> &found)
+{
+    // (state has been prepared)
+    // `found` may be shared with other threads searching other parts of the tree
+    // and everyone stops as soon as it reaches the limit
+    int cell = guessCell(state);
+    if (cell < 0)
+    {
+        found++;
+        return;
+    }
+    BoardState next;
+    for (uint16_t mask = state.cellPossibilities[cell]; mask != 0; mask &= mask - 1)
+    {
+        if (found.load(std::memory_order_relaxed) >= limit)
+            return;
+        if (guess(state, cell, lowestBit64(mask), next))
+            countSolutionsFrom(next, limit, found);
+    }
+}
+
+/*static*/ int BoardSearch::countSolutions(const BoardState &state, int limit, int threadCount /*= 1*/)
+{
+    // count the solutions of a board, stopping once `limit` have been found
+    // (so a limit of 2 tells whether a board has no solution, just one, or more than one)
+    // with more than one thread the top levels of the search are split out into subtrees
+    // which the threads then take from a shared list
+    BoardState root(state);
+    if (limit <= 0 || !prepare(root))
+        return 0;
+    std::atomic<int> found(0);
+    if (threadCount <= 1)
+    {
+        countSolutionsFrom(root, limit, found);
+        return std::min(found.load(), limit);
+    }
+
+    std::vector<BoardState> subtrees(1, root);
+    while (subtrees.size() < size_t(threadCount) * 8 && found < limit)
+    {
+        std::vector<BoardState> next;
+        for (const BoardState &subtree : subtrees)
+        {
+            int cell = guessCell(subtree);
+            if (cell < 0)
+            {
+                found++;
+                continue;
+            }
+            BoardState child;
+            for (uint16_t mask = subtree.cellPossibilities[cell]; mask != 0; mask &= mask - 1)
+                if (guess(subtree, cell, lowestBit64(mask), child))
+                    next.push_back(child);
+        }
+        subtrees.swap(next);
+        if (subtrees.empty())
+            break;
+    }
+    if (found >= limit)
+        return limit;
+
+    std::atomic<size_t> nextSubtree(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; i++)
+        threads.emplace_back([&]()
+        {
+            for (size_t index = nextSubtree++; index < subtrees.size(); index = nextSubtree++)
+            {
+                if (found.load(std::memory_order_relaxed) >= limit)
+                    return;
+                countSolutionsFrom(subtrees[index], limit, found);
+            }
+        });
+    for (std::thread &thread : threads)
+        thread.join();
+    return std::min(found.load(), limit);
+}
+
+/*static*/ void BoardSearch::splitSubtrees(const BoardState &state, int levels, std::vector<BoardState> &subtrees)
+{
+    // split the top `levels` levels of the search below a (prepared) board out into subtrees, in search order
+    // a board which is solved before then is a subtree of its own
+    subtrees.assign(1, state);
+    for (int level = 0; level < levels; level++)
+    {
+        std::vector<BoardState> next;
+        for (const BoardState &subtree : subtrees)
+        {
+            int cell = guessCell(subtree);
+            if (cell < 0)
+            {
+                next.push_back(subtree);
+                continue;
+            }
+            BoardState child;
+            for (uint16_t mask = subtree.cellPossibilities[cell]; mask != 0; mask &= mask - 1)
+                if (guess(subtree, cell, lowestBit64(mask), child))
+                    next.push_back(child);
+        }
+        subtrees.swap(next);
+    }
+}
+
+/*static*/ void BoardSearch::enumerateSolutionsFrom(const BoardState &state, Enumeration &enumeration, int subtree,
+                                                    std::vector<uint8_t> &guesses, const std::vector<uint8_t> &resumeGuesses, bool &resuming)
+{
+    // (state has been prepared)
+    // `guesses` are the numbers guessed from the subtree's root down to here
+    // while `resuming` the search skips forward along `resumeGuesses`, to just past the solution they led to last time
+    int cell = guessCell(state);
+    if (cell < 0)
+    {
+        if (resuming)
+        {
+            resuming = false;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(enumeration.mutex);
+        if (enumeration.stopped)
+            return;
+        enumeration.count++;
+        enumeration.cursor->subtreeStatus[subtree] = SearchCursor::Started;
+        enumeration.cursor->subtreeGuesses[subtree] = guesses;
+        if (!(*enumeration.callback)(state) || enumeration.count >= enumeration.maxCount)
+            enumeration.stopped = true;
+        return;
+    }
+    size_t level = guesses.size();
+    if (resuming && level >= resumeGuesses.size())
+        resuming = false;
+    BoardState next;
+    for (uint16_t mask = state.cellPossibilities[cell]; mask != 0; mask &= mask - 1)
+    {
+        if (enumeration.stopped)
+            return;
+        int num = lowestBit64(mask);
+        if (resuming && num < resumeGuesses[level])
+            continue;
+        if (resuming && num > resumeGuesses[level])
+            resuming = false;
+        if (!guess(state, cell, num, next))
+            continue;
+        guesses.push_back(uint8_t(num));
+        enumerateSolutionsFrom(next, enumeration, subtree, guesses, resumeGuesses, resuming);
+        guesses.pop_back();
+        resuming = false;
+    }
+}
+
+/*static*/ long long BoardSearch::enumerateSolutions(const BoardState &state, const SolutionCallback &callback, long long maxCount, SearchCursor &cursor, int threadCount /*= 1*/)
+{
+    // call `callback` for each solution of a board, in turn, without holding on to any of them
+    // until `maxCount` solutions have been found or the callback returns false
+    // `cursor` says where to start from (an unstarted cursor for the beginning) and is updated to where it stopped
+    // with more than one thread, the top levels of the search are split out into subtrees which the threads share
+    // solutions then do not come in search order, but the callback is still only called by one thread at a time
+    // return the number of solutions found
+    if (cursor.isFinished() || maxCount <= 0)
+        return 0;
+    BoardState root(state);
+    if (!prepare(root))
+    {
+        cursor.splitLevels = 0;
+        cursor.subtreeStatus.assign(1, SearchCursor::Done);
+        cursor.subtreeGuesses.assign(1, std::vector<uint8_t>());
+        return 0;
+    }
+
+    std::vector<BoardState> subtrees;
+    if (cursor.isStarted())
+    {
+        splitSubtrees(root, cursor.splitLevels, subtrees);
+        if (subtrees.size() != cursor.subtreeStatus.size())
+            throw std::runtime_error("Enumeration cursor does not match board");
+    }
+    else
+    {
+        cursor.splitLevels = 0;
+        splitSubtrees(root, 0, subtrees);
+        while (threadCount > 1 && subtrees.size() < size_t(threadCount) * 8 && cursor.splitLevels < 81)
+            splitSubtrees(root, ++cursor.splitLevels, subtrees);
+        cursor.subtreeStatus.assign(subtrees.size(), SearchCursor::Pending);
+        cursor.subtreeGuesses.assign(subtrees.size(), std::vector<uint8_t>());
+    }
+
+    Enumeration enumeration;
+    enumeration.callback = &callback;
+    enumeration.cursor = &cursor;
+    enumeration.maxCount = maxCount;
+    enumeration.count = 0;
+    enumeration.stopped = false;
+    std::atomic<size_t> nextSubtree(0);
+    auto worker = [&]()
+    {
+        for (size_t subtree = nextSubtree++; subtree < subtrees.size() && !enumeration.stopped; subtree = nextSubtree++)
+        {
+            std::vector<uint8_t> resumeGuesses;
+            bool resuming;
+            {
+                std::lock_guard<std::mutex> lock(enumeration.mutex);
+                if (cursor.subtreeStatus[subtree] == SearchCursor::Done)
+                    continue;
+                resumeGuesses = cursor.subtreeGuesses[subtree];
+                resuming = (cursor.subtreeStatus[subtree] == SearchCursor::Started);
+            }
+            std::vector<uint8_t> guesses;
+            enumerateSolutionsFrom(subtrees[subtree], enumeration, int(subtree), guesses, resumeGuesses, resuming);
+            std::lock_guard<std::mutex> lock(enumeration.mutex);
+            if (!enumeration.stopped)
+            {
+                cursor.subtreeStatus[subtree] = SearchCursor::Done;
+                cursor.subtreeGuesses[subtree].clear();
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount && size_t(i) < subtrees.size(); i++)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &thread : threads)
+        thread.join();
+    return enumeration.count;
+}
+
+/*static*/ bool BoardSearch::randomSolutionFrom(const BoardState &state, std::mt19937_64 &random, BoardState &solution)
+{
+    // (state has been prepared)
+    int cell = guessCell(state);
+    if (cell < 0)
+    {
+        solution = state;
+        return true;
+    }
+    int nums[9], count = 0;
+    for (uint16_t mask = state.cellPossibilities[cell]; mask != 0; mask &= mask - 1)
+        nums[count++] = lowestBit64(mask);
+    std::shuffle(nums, nums + count, random);
+    BoardState next;
+    for (int i = 0; i < count; i++)
+        if (guess(state, cell, nums[i], next) && randomSolutionFrom(next, random, solution))
+            return true;
+    return false;
+}
+
+/*static*/ bool BoardSearch::randomSolution(const BoardState &state, std::mt19937_64 &random, BoardState &solution)
+{
+    // find a solution of a board, picking at random among the possibilities at each guess
+    // (so from an empty board this makes a random complete board)
+    // return false if the board has no solution
+    BoardState root(state);
+    if (!prepare(root))
+        return false;
+    return randomSolutionFrom(root, random, solution);
+}
@@ -0,0 +1,66 @@
+#ifndef BOARDSEARCH_H
+#define BOARDSEARCH_H
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "boardstate.h"
+
+////////// STRUCT SearchCursor //////////
+// how far an enumeration of solutions has got, so that it can be resumed later
+// the top `splitLevels` levels of the search are split out into subtrees (so they can be shared among threads)
+// and for each subtree it records whether it is still to do, finished, or the guesses which led to its last solution
+struct SearchCursor
+{
+    enum SubtreeStatus { Pending, Started, Done };
+
+    int splitLevels;
+    std::vector<SubtreeStatus> subtreeStatus;
+    std::vector<std::vector<uint8_t> > subtreeGuesses;
+
+    SearchCursor() { splitLevels = -1; }
+    bool isStarted() const { return (splitLevels >= 0); }
+    bool isFinished() const;
+    std::string toString() const;
+    bool fromString(const std::string &str);
+};
+
+
+////////// CLASS BoardSearch //////////
+// exhaustive search for the solutions of a board, for where logic alone is not enough
+// each node of the search places all the singles it can before guessing
+// and it always guesses in a cell with the fewest possibilities
+class BoardSearch
+{
+public:
+    typedef std::function<bool(const BoardState &solution)> SolutionCallback;
+
+    static int countSolutions(const BoardState &state, int limit, int threadCount = 1);
+    static long long enumerateSolutions(const BoardState &state, const SolutionCallback &callback, long long maxCount, SearchCursor &cursor, int threadCount = 1);
+    static bool randomSolution(const BoardState &state, std::mt19937_64 &random, BoardState &solution);
+
+private:
+    struct Enumeration
+    {
+        const SolutionCallback *callback;
+        SearchCursor *cursor;
+        long long maxCount, count;
+        std::mutex mutex;
+        std::atomic<bool> stopped;
+    };
+
+    static bool prepare(BoardState &state);
+    static int guessCell(const BoardState &state);
+    static bool guess(const BoardState &state, int cell, int num, BoardState &result);
+    static void countSolutionsFrom(const BoardState &state, int limit, std::atomic<int> &found);
+    static bool randomSolutionFrom(const BoardState &state, std::mt19937_64 &random, BoardState &solution);
+    static void splitSubtrees(const BoardState &state, int levels, std::vector<BoardState> &subtrees);
+    static void enumerateSolutionsFrom(const BoardState &state, Enumeration &enumeration, int subtree,
+                                       std::vector<uint8_t> &guesses, const std::vector<uint8_t> &resumeGuesses, bool &resuming);
+};
+
+#endif // BOARDSEARCH_H
@@ -0,0 +1,1009 @@
+#include <algorithm>
+
+#include "boardlayout.h"
+#include "boardsolver.h"
+
+
+////////// STRUCT TechniqueStats //////////
+
+void TechniqueStats::clear()
+{
+    std::fill(tries, tries + TechniqueCount, 0);
+    std::fill(hits, hits + TechniqueCount, 0);
+    std::fill(nsecs, nsecs + TechniqueCount, 0);
+}
+
+double TechniqueStats::costPerHit(Technique technique) const
+{
+    // the time spent on a technique for each time it removed possibilities
+    // one hit more than it has had, so one never tried costs nothing and so comes first, and one never hitting is not infinite
+    return double(nsecs[technique]) / double(hits[technique] + 1);
+}
+
+
+////////// CLASS BoardSolver //////////
+
+BoardSolver::BoardSolver()
+{
+    _chainTimeBudget = 50;
+    _probeBudget = 100;
+    _lastStepPass = 0;
+    _adaptiveOrdering = false;
+    sharedStats = nullptr;
+    stepDeadlineSet = false;
+}
+
+///// STRUCT StrongLinkGraph /////
+
+void BoardSolver::StrongLinkGraph::build(const BoardState &state)
+{
+    bivalueCells = Bitboard81();
+    for (int row = 0; row < 9; row++)
+        for (int col = 0; col < 9; col++)
+            updateCell(state, row, col);
+    for (int num = 1; num <= 9; num++)
+        for (int unit = 0; unit < state.layout->unitCount; unit++)
+            updateUnit(state, unit, num);
+    valid = true;
+}
+
+void BoardSolver::StrongLinkGraph::updateCell(const BoardState &state, int row, int col)
+{
+    uint16_t mask = state.cellPossibilities[row * 9 + col];
+    uint16_t maskLessLowest = mask & (mask - 1);
+    if (maskLessLowest != 0 && (maskLessLowest & (maskLessLowest - 1)) == 0)
+        bivalueCells.set(row * 9 + col);
+    else
+        bivalueCells.clear(row * 9 + col);
+}
+
+void BoardSolver::StrongLinkGraph::updateUnit(const BoardState &state, int unit, int num)
+{
+    const BoardLayout &layout(*state.layout);
+    const uint8_t *unitCells = layout.unitCells[unit];
+    int indexes[2], count = 0;
+    for (int index = 0; index < 9; index++)
+    {
+        conjugates[num][unitCells[index]][layout.unitCellSlots[unit][index]] = -1;
+        if (state.numPossibilities[num].test(unitCells[index]) && count++ < 2)
+            indexes[count - 1] = index;
+    }
+    if (count != 2)
+        return;
+    conjugates[num][unitCells[indexes[0]]][layout.unitCellSlots[unit][indexes[0]]] = int8_t(unitCells[indexes[1]]);
+    conjugates[num][unitCells[indexes[1]]][layout.unitCellSlots[unit][indexes[1]]] = int8_t(unitCells[indexes[0]]);
+}
+
+
+int BoardSolver::chainTimeBudget() const
+{
+    return _chainTimeBudget;
+}
+
+void BoardSolver::setChainTimeBudget(int msecs)
+{
+    _chainTimeBudget = msecs;
+}
+
+int BoardSolver::probeBudget() const
+{
+    return _probeBudget;
+}
+
+void BoardSolver::setProbeBudget(int probes)
+{
+    _probeBudget = probes;
+}
+
+bool BoardSolver::adaptiveOrdering() const
+{
+    return _adaptiveOrdering;
+}
+
+void BoardSolver::setAdaptiveOrdering(bool adaptive, TechniqueStats *sharedStats /*= nullptr*/)
+{
+    // adaptively, the techniques within passes 3 and 4 are tried cheapest per hit first, from the stats kept in `sharedStats`
+    // (or the solver's own if null); otherwise always in the same order, so the same steps are found every time
+    // either way a step is credited to the same pass, as the passes themselves are always tried in order
+    _adaptiveOrdering = adaptive;
+    this->sharedStats = sharedStats;
+}
+
+const TechniqueStats &BoardSolver::techniqueStats() const
+{
+    return (sharedStats != nullptr) ? *sharedStats : ownStats;
+}
+
+void BoardSolver::setPossibility(int row, int col, int num, bool possible)
+{
+    if (!state.setPossibility(row, col, num, possible))
+        return;
+    if (strongLinks.valid)
+    {
+        // the strong link graph only follows possibilities being removed
+        if (possible)
+            strongLinks.valid = false;
+        else
+        {
+            strongLinks.updateCell(state, row, col);
+            int cell = row * 9 + col;
+            for (int slot = 0; slot < layout().cellUnitCounts[cell]; slot++)
+                strongLinks.updateUnit(state, layout().cellUnits[cell][slot], num);
+        }
+    }
+}
+
+void BoardSolver::resetAllPossibilities()
+{
+    state.resetAllPossibilities();
+    strongLinks.valid = false;
+}
+
+void BoardSolver::reduceAllPossibilities()
+{
+    // (the strong link graph is rebuilt once per step, when it is next needed)
+    state.reduceAllPossibilities();
+    strongLinks.valid = false;
+}
+
+void BoardSolver::placeNum(int row, int col, int num)
+{
+    // place a number, reducing the possibilities of just the cells which see it
+    // (the same as `reduceAllPossibilities()` after it, when the possibilities have been reduced since the last number)
+    state.setNumInCell(row, col, num);
+    state.reducePossibilities(row, col);
+    strongLinks.valid = false;
+}
+
+CellNum BoardSolver::solveFindStepPass1() const
+{
+    // find if there is a cell which has just 1 possibility available
+    int num;
+    for (int row = 0; row < 9; row++)
+        for (int col = 0; col < 9; col++)
+            if (state.cellHasOnePossibility(row, col, num))
+                return CellNum(row, col, num);
+    return CellNum();
+}
+
+CellNum BoardSolver::cellGroupOnlyPossibilityForNum(int unit) const
+{
+    // (possibilities are only searched once they have been reduced, when occupied cells have none)
+    // first find the numbers which are possible in just one cell of the group
+    // then return the first cell (in group order) which has one of those numbers
+    const Bitboard81 &groupCells(layout().unitBoards[unit]);
+    uint16_t onlyOnceNums = 0;
+    for (int num = 1; num <= 9; num++)
+        if ((state.numPossibilities[num] & groupCells).count() == 1)
+            onlyOnceNums |= (1 << num);
+    if (onlyOnceNums == 0)
+        return CellNum();
+    for (int index = 0; index < 9; index++)
+    {
+        int cell = layout().unitCells[unit][index];
+        uint16_t mask = cellPossibilitiesMask(cell) & onlyOnceNums;
+        if (mask != 0)
+            return CellNum(cell / 9, cell % 9, lowestBit64(mask));
+    }
+    return CellNum();
+}
+
+CellNum BoardSolver::solveFindStepPass2() const
+{
+    // find if there is a "group" (row/column/square, or a variant's extra unit) of cells
+    // where there is some possibility which is only available *once* in the group
+    CellNum cellNum;
+    for (int i = 0; i < layout().unitCount; i++)
+        if (!(cellNum = cellGroupOnlyPossibilityForNum(unitColumnsFirst(i))).isEmpty())
+            return cellNum;
+    return CellNum();
+}
+
+void BoardSolver::cellGroupPossibilitiesByIndex(int unit, uint16_t groupPossibilities[9]) const
+{
+    // fill an array indexed by "group" element index
+    // where each array element is a mask of which numbers are possible in the group element index
+    const uint8_t *groupCells = layout().unitCells[unit];
+    for (int index = 0; index < 9; index++)
+    {
+        int cell = groupCells[index];
+        groupPossibilities[index] = (state.nums[cell] == 0) ? cellPossibilitiesMask(cell) : 0;
+    }
+}
+
+bool BoardSolver::reduceCellGroupPossibilitiesForIdenticalPairs(int unit)
+{
+    // if within a "group" we find 2 cells
+    // where each cell has just 2 possibilities *and* those numbers are the same in both cells
+    // we can go through all *other* cells in the group removing those 2 numbers from their possibles
+    uint16_t groupPossibilities[9];
+    cellGroupPossibilitiesByIndex(unit, groupPossibilities);
+
+    bool changed = false;
+    for (int cell1 = 0; cell1 < 9; cell1++)
+    {
+        if (bitCount64(groupPossibilities[cell1]) != 2)
+            continue;
+        for (int cell2 = cell1 + 1; cell2 < 9; cell2++)
+        {
+            if (groupPossibilities[cell2] != groupPossibilities[cell1])
+                continue;
+            int num1 = lowestBit64(groupPossibilities[cell1]);
+            int num2 = lowestBit64(groupPossibilities[cell1] & ~(1 << num1));
+            for (int index = 0; index < 9; index++)
+                if (index != cell1 && index != cell2)
+                {
+                    int row = layout().unitCells[unit][index] / 9, col = layout().unitCells[unit][index] % 9;
+                    if (cellHasPossibility(row, col, num1) || cellHasPossibility(row, col, num2))
+                    {
+                        changed = true;
+                        setPossibility(row, col, num1, false);
+                        setPossibility(row, col, num2, false);
+                    }
+                }
+        }
+    }
+    return changed;
+}
+
+bool BoardSolver::reduceAllGroupPossibilitiesForIdenticalPairs()
+{
+    // find if there are any "groups" (row/column/square) of cells
+    // where there are 2 cells which both have just 2 possibilities and those are the same possibilities
+    // from that we can reduce the possibilities in other members of the group to eliminate those 2 possibilities
+    bool changed = false;
+    for (int i = 0; i < layout().unitCount; i++)
+        if (reduceCellGroupPossibilitiesForIdenticalPairs(unitColumnsFirst(i)))
+            changed = true;
+    return changed;
+}
+
+uint16_t BoardSolver::groupIndexPossibilitiesForNumber(int unit, int num) const
+{
+    // return a mask of which cell indexes within a group are possible for a number
+    // (possibilities are only searched once they have been reduced, when occupied cells have none)
+    uint16_t indexes = 0;
+    for (int index = 0; index < 9; index++)
+        if (state.numPossibilities[num].test(layout().unitCells[unit][index]))
+            indexes |= (1 << index);
+    return indexes;
+}
+
+void BoardSolver::cellGroupPossibilitiesByNumber(int unit, uint16_t groupPossibilities[10]) const
+{
+    // fill an array indexed by possibility number
+    // where each array element is a mask of which "group" element indexes are possible for the number
+    groupPossibilities[0] = 0;
+    for (int num = 1; num <= 9; num++)
+        groupPossibilities[num] = groupIndexPossibilitiesForNumber(unit, num);
+}
+
+bool BoardSolver::reduceCellGroupPossibilitiesForUniquePairs(int unit)
+{
+    // if within a "group" we find 2 cells
+    // which have among their (any number of) possibilities some 2 common possible numbers
+    // where neither of those 2 numbers is in any *other* cells' possibilities
+    // we can reduce the possibilities in those 2 cells to eliminate any *other* possibilities
+    // *and* then we can reduce the possibilities in any *other* cells to remove the 2 numbers
+    uint16_t groupPossibilities[10];
+    cellGroupPossibilitiesByNumber(unit, groupPossibilities);
+
+    bool changed = false;
+    for (int num1 = 1; num1 <= 9; num1++)
+    {
+        if (bitCount64(groupPossibilities[num1]) != 2)
+            continue;
+        for (int num2 = num1 + 1; num2 <= 9; num2++)
+        {
+            if (groupPossibilities[num2] != groupPossibilities[num1])
+                continue;
+            uint16_t pairIndexes = groupPossibilities[num1];
+            for (int index = 0; index < 9; index++)
+            {
+                int row = layout().unitCells[unit][index] / 9, col = layout().unitCells[unit][index] % 9;
+                if ((pairIndexes & (1 << index)) != 0)
+                {
+                    for (int num = 1; num <= 9; num++)
+                        if (num != num1 && num != num2)
+                            if (cellHasPossibility(row, col, num))
+                            {
+                                changed = true;
+                                setPossibility(row, col, num, false);
+                            }
+                }
+                else
+                {
+                    if (cellHasPossibility(row, col, num1) || cellHasPossibility(row, col, num2))
+                    {
+                        changed = true;
+                        setPossibility(row, col, num1, false);
+                        setPossibility(row, col, num2, false);
+                    }
+                }
+            }
+        }
+    }
+    return changed;
+}
+
+bool BoardSolver::reduceAllGroupPossibilitiesForUniquePairs()
+{
+    // find if there are any "groups" (row/column/square) of cells
+    // where there are just 2 cells which both have among their (any number of) possibilities
+    // some 2 numbers neither of which is in any *other* cells' possibilities
+    // from that we can reduce the possibilities in those 2 cells to eliminate any *other* possibilities
+    // *and* then we will be able to reduce the possibilities in other members of the group to eliminate those 2 possibilities
+    // per `reduceAllGroupPossibilitiesForIdenticalPairs()`
+    bool changed = false;
+    for (int i = 0; i < layout().unitCount; i++)
+        if (reduceCellGroupPossibilitiesForUniquePairs(unitColumnsFirst(i)))
+            changed = true;
+    return changed;
+}
+
+bool BoardSolver::reduceRowColumnPossibilitiesForSquare(int param)
+{
+    // find if in a square
+    // there is a number *all* of whose possibilities lie *only* in a row or a column in the square
+    // from that we can reduce the possibilities in any *other* squares the row or column runs through
+    // (this works directly on the number-major possibilities: the square's cells for a number
+    // lie in one row or column if they are a subset of that row's or column's cells)
+    // (a jigsaw's irregular box can have more than 3 cells in a line, so the subset test is all there is)
+    const Bitboard81 &squareCells(layout().unitBoards[Square * 9 + param]);
+
+    bool changed = false;
+    for (int num = 1; num <= 9; num++)
+    {
+        Bitboard81 cells(state.numPossibilities[num] & squareCells);
+        int count = cells.count();
+        if (count < 2)
+            continue;
+        int cell0 = cells.first();
+        Bitboard81 lineCells(layout().unitBoards[Row * 9 + cell0 / 9]);
+        if ((cells & lineCells) != cells)
+            lineCells = layout().unitBoards[Column * 9 + cell0 % 9];
+        if ((cells & lineCells) != cells)
+            continue;
+        Bitboard81 others(state.numPossibilities[num] & lineCells & ~squareCells);
+        for (int cell = others.takeFirst(); cell >= 0; cell = others.takeFirst())
+        {
+            changed = true;
+            setPossibility(cell / 9, cell % 9, num, false);
+        }
+    }
+    return changed;
+}
+
+bool BoardSolver::reduceAllRowColumnPossibilitiesForSquares()
+{
+    // find if there are any squares of cells
+    // where there is a number *all* of whose possibilities lie *only* in a row or a column in the square
+    // from that we can reduce the possibilities in any *other* squares the row or column runs through
+    bool changed = false;
+    for (int param = 0; param < 9; param++)
+        if (reduceRowColumnPossibilitiesForSquare(param))
+            changed = true;
+    return changed;
+}
+
+bool BoardSolver::reduceAllPossibilitiesFor(TechniqueStats::Technique technique)
+{
+    switch (technique)
+    {
+    case TechniqueStats::IdenticalPairs: return reduceAllGroupPossibilitiesForIdenticalPairs();
+    case TechniqueStats::UniquePairs: return reduceAllGroupPossibilitiesForUniquePairs();
+    case TechniqueStats::RowColumnForSquares: return reduceAllRowColumnPossibilitiesForSquares();
+    case TechniqueStats::XYWings: return reduceAllPossibilitiesForXYWings();
+    case TechniqueStats::SimpleColouring: return reduceAllPossibilitiesForSimpleColouring();
+    case TechniqueStats::Templates: return reduceAllPossibilitiesForTemplates();
+    default: return false;
+    }
+}
+
+bool BoardSolver::tryTechnique(TechniqueStats::Technique technique)
+{
+    // apply a technique, timing it and counting whether it hit when ordering adaptively
+    if (!_adaptiveOrdering)
+        return reduceAllPossibilitiesFor(technique);
+    TechniqueStats &stats((sharedStats != nullptr) ? *sharedStats : ownStats);
+    std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+    bool changed = reduceAllPossibilitiesFor(technique);
+    stats.nsecs[technique] += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    stats.tries[technique]++;
+    if (changed)
+        stats.hits[technique]++;
+    return changed;
+}
+
+void BoardSolver::orderTechniques(TechniqueStats::Technique *techniques, int count) const
+{
+    // put the techniques cheapest per hit first when ordering adaptively, keeping the usual order between equals
+    if (!_adaptiveOrdering)
+        return;
+    const TechniqueStats &stats(techniqueStats());
+    std::stable_sort(techniques, techniques + count,
+                     [&stats](TechniqueStats::Technique a, TechniqueStats::Technique b) { return stats.costPerHit(a) < stats.costPerHit(b); });
+}
+
+CellNum BoardSolver::solveFindStepPass3()
+{
+    TechniqueStats::Technique techniques[] = { TechniqueStats::IdenticalPairs, TechniqueStats::UniquePairs, TechniqueStats::RowColumnForSquares };
+    bool changed;
+    do
+    {
+        orderTechniques(techniques, 3);
+        changed = false;
+        for (int i = 0; i < 3 && !changed; i++)
+            changed = tryTechnique(techniques[i]);
+        if (changed)
+        {
+            CellNum cellnum = solveFindStepPass1();
+            if (!cellnum.isEmpty())
+                return cellnum;
+            cellnum = solveFindStepPass2();
+            if (!cellnum.isEmpty())
+                return cellnum;
+        }
+    } while (changed);
+    return CellNum();
+}
+
+bool BoardSolver::reduceAllPossibilitiesForXYWings()
+{
+    // find a "pivot" cell with just 2 possibilities (x,y)
+    // which sees 2 "pincer" cells with just 2 possibilities (x,z) and (y,z)
+    // whichever of x or y goes in the pivot one of the pincers must be z
+    // so we can remove z from the possibilities of any cell which sees both pincers
+    bool changed = false;
+    Bitboard81 pivots(strongLinks.bivalueCells);
+    for (int pivot = pivots.takeFirst(); pivot >= 0; pivot = pivots.takeFirst())
+    {
+        // (`pivots` and `pincers` are copies, so an elimination made meanwhile may have left one with a single possibility)
+        if (!strongLinks.bivalueCells.test(pivot))
+            continue;
+        uint16_t pivotMask = cellPossibilitiesMask(pivot);
+        Bitboard81 pincers(strongLinks.bivalueCells & layout().peerBoards[pivot]);
+        for (int pincer1 = pincers.takeFirst(); pincer1 >= 0; pincer1 = pincers.takeFirst())
+        {
+            uint16_t mask1 = cellPossibilitiesMask(pincer1);
+            uint16_t shared = mask1 & pivotMask;
+            if (!strongLinks.bivalueCells.test(pincer1) || shared == 0 || (shared & (shared - 1)) != 0)
+                continue;
+            uint16_t mask2 = (pivotMask & ~shared) | (mask1 & ~shared);
+            int z = lowestBit64(mask1 & ~shared);
+            Bitboard81 pincers2(pincers);
+            for (int pincer2 = pincers2.takeFirst(); pincer2 >= 0; pincer2 = pincers2.takeFirst())
+            {
+                if (cellPossibilitiesMask(pincer2) != mask2)
+                    continue;
+                Bitboard81 cells(state.numPossibilities[z]
+                                 & layout().peerBoards[pincer1]
+                                 & layout().peerBoards[pincer2]);
+                for (int cell = cells.takeFirst(); cell >= 0; cell = cells.takeFirst())
+                {
+                    changed = true;
+                    setPossibility(cell / 9, cell % 9, z, false);
+                }
+            }
+        }
+    }
+    return changed;
+}
+
+bool BoardSolver::reducePossibilitiesForSimpleColouring(int num)
+{
+    // colour the cells joined by conjugate pairs for a number alternately "on" and "off"
+    // the number must go in all the cells of one colour and in none of the other
+    // if 2 cells of the same colour see each other that colour cannot be the true one
+    // so we can remove the number from all cells of that colour
+    // otherwise we can remove the number from any uncoloured cell which sees cells of both colours
+    bool changed = false;
+    Bitboard81 uncoloured(state.numPossibilities[num]);
+    for (int start = uncoloured.takeFirst(); start >= 0; start = uncoloured.takeFirst())
+    {
+        Bitboard81 colours[2];
+        int queue[81], queueHead = 0, queueTail = 0;
+        colours[0].set(start);
+        queue[queueTail++] = start;
+        while (queueHead < queueTail)
+        {
+            int cell = queue[queueHead++];
+            int colour = colours[0].test(cell) ? 0 : 1;
+            for (int slot = 0; slot < layout().cellUnitCounts[cell]; slot++)
+            {
+                int other = strongLinks.conjugates[num][cell][slot];
+                if (other < 0 || colours[0].test(other) || colours[1].test(other))
+                    continue;
+                colours[1 - colour].set(other);
+                queue[queueTail++] = other;
+            }
+        }
+        if (queueTail < 2)
+            continue;
+        uncoloured &= ~(colours[0] | colours[1]);
+
+        Bitboard81 sees[2];
+        for (int colour = 0; colour < 2; colour++)
+        {
+            Bitboard81 cells(colours[colour]);
+            for (int cell = cells.takeFirst(); cell >= 0; cell = cells.takeFirst())
+                sees[colour] |= layout().peerBoards[cell];
+        }
+        Bitboard81 cells;
+        if (!(sees[0] & colours[0]).isEmpty())
+            cells = colours[0];
+        else if (!(sees[1] & colours[1]).isEmpty())
+            cells = colours[1];
+        else
+            cells = state.numPossibilities[num] & sees[0] & sees[1] & ~(colours[0] | colours[1]);
+        for (int cell = cells.takeFirst(); cell >= 0; cell = cells.takeFirst())
+        {
+            changed = true;
+            setPossibility(cell / 9, cell % 9, num, false);
+        }
+    }
+    return changed;
+}
+
+bool BoardSolver::reduceAllPossibilitiesForSimpleColouring()
+{
+    bool changed = false;
+    for (int num = 1; num <= 9; num++)
+        if (reducePossibilitiesForSimpleColouring(num))
+            changed = true;
+    return changed;
+}
+
+bool BoardSolver::reduceAllPossibilitiesForTemplates()
+{
+    // "templates" (pattern overlay): a number's 9 cells in a solution are one in each row, column and square,
+    // and there are just 46656 such placements of a number, made once into a table of 81-bit masks
+    // for each number keep only the templates covering every cell it is in and no cell where it is not possible
+    // it cannot be in a cell no surviving template covers, and must be in a cell every one of them covers
+    struct TemplateTable
+    {
+        // the templates go in order of the column in each row, so those with the same columns in the top rows are together
+        // the search goes down the top rows' columns where the number is still possible, into blocks of templates
+        // sharing them, each checked by a loop over plain arrays with no branches, which the compiler can vectorise
+        enum { Count = 46656, BlockRows = 4, BlockSize = 48 };
+        uint64_t lo[Count], hi[Count];
+
+        TemplateTable()
+        {
+            int count = 0, cols[9];
+            add(0, 0, cols, Bitboard81(), count);
+        }
+
+        static bool colAllowed(int row, int col, uint16_t usedCols, const int cols[])
+        {
+            // not a column used above, nor in a square used by a row above in the same band
+            if ((usedCols & (1 << col)) != 0)
+                return false;
+            for (int row2 = row / 3 * 3; row2 < row; row2++)
+                if (cols[row2] / 3 == col / 3)
+                    return false;
+            return true;
+        }
+
+        void add(int row, uint16_t usedCols, int cols[], const Bitboard81 &board, int &count)
+        {
+            if (row == 9)
+            {
+                lo[count] = board.lo;
+                hi[count] = board.hi;
+                count++;
+                return;
+            }
+            for (int col = 0; col < 9; col++)
+                if (colAllowed(row, col, usedCols, cols))
+                {
+                    cols[row] = col;
+                    Bitboard81 next(board);
+                    next.set(row * 9 + col);
+                    add(row + 1, uint16_t(usedCols | (1 << col)), cols, next, count);
+                }
+        }
+
+        void search(int row, uint16_t usedCols, int cols[], int start, const Bitboard81 &allowed, const Bitboard81 &placed,
+                    uint64_t found[4]) const
+        {
+            // `found` gathers the union (lo, hi) and the intersection (lo, hi) of the surviving templates
+            static const int blockSizes[BlockRows] = { Count / 9, Count / 9 / 6, Count / 9 / 6 / 3, BlockSize };
+            if (row == BlockRows)
+            {
+                uint64_t notAllowedLo = ~allowed.lo, notAllowedHi = ~allowed.hi;
+                for (int i = start; i < start + BlockSize; i++)
+                {
+                    uint64_t bad = (lo[i] & notAllowedLo) | (hi[i] & notAllowedHi) | (placed.lo & ~lo[i]) | (placed.hi & ~hi[i]);
+                    uint64_t keep = uint64_t(0) - uint64_t(bad == 0);
+                    found[0] |= lo[i] & keep;
+                    found[1] |= hi[i] & keep;
+                    found[2] &= lo[i] | ~keep;
+                    found[3] &= hi[i] | ~keep;
+                }
+                return;
+            }
+            for (int col = 0; col < 9; col++)
+                if (colAllowed(row, col, usedCols, cols))
+                {
+                    if (allowed.test(row * 9 + col))
+                    {
+                        cols[row] = col;
+                        search(row + 1, uint16_t(usedCols | (1 << col)), cols, start, allowed, placed, found);
+                    }
+                    start += blockSizes[row];
+                }
+        }
+    };
+    static const TemplateTable table;
+    // (the table is of the regular squares, so a jigsaw's boxes get nothing from it; extra units only narrow a number's
+    // placements further, which the table's templates still include, so for those it stays sound)
+    if (!layout().hasRegularBoxes())
+        return false;
+
+    Bitboard81 placed[10];
+    for (int cell = 0; cell < 81; cell++)
+        placed[state.nums[cell]].set(cell);
+    bool changed = false;
+    for (int num = 1; num <= 9; num++)
+    {
+        if (placed[num].count() == 9)
+            continue;
+        uint64_t found[4] = { 0, 0, ~uint64_t(0), ~uint64_t(0) };
+        int cols[9];
+        table.search(0, 0, cols, 0, placed[num] | state.numPossibilities[num], placed[num], found);
+        // (no templates at all means the board has a contradiction, which is not for this technique to report)
+        if (found[0] == 0 && found[1] == 0)
+            continue;
+        Bitboard81 uncovered(state.numPossibilities[num] & ~Bitboard81(found[0], found[1]));
+        for (int cell = uncovered.takeFirst(); cell >= 0; cell = uncovered.takeFirst())
+        {
+            setPossibility(cell / 9, cell % 9, num, false);
+            changed = true;
+        }
+        Bitboard81 forced(state.numPossibilities[num] & Bitboard81(found[2], found[3]));
+        for (int cell = forced.takeFirst(); cell >= 0; cell = forced.takeFirst())
+            for (uint16_t others = cellPossibilitiesMask(cell) & ~(1 << num); others != 0; others &= others - 1)
+            {
+                setPossibility(cell / 9, cell % 9, lowestBit64(others), false);
+                changed = true;
+            }
+    }
+    return changed;
+}
+
+bool BoardSolver::reducePossibilitiesForChainsFrom(int cell, int num)
+{
+    // search breadth-first for an "alternating inference chain" starting with a strong link out of (cell,num)
+    // nodes are (cell,num) possibilities, and the chain alternates strong and weak links:
+    // after a strong link a node is "on" (if the previous node is not true, this one must be)
+    // after a weak link a node is "off" (if the previous node is true, this one cannot be)
+    // so every "on" node reached is true if the start is not: one or other of them must be true
+    // and we can remove any possibility which sees both the start and that node
+    // (seeing means being the same number in a cell which sees the other's cell, or another number in the same cell)
+    static const int maxChainLength = 12;
+    static const int nodeCount = 81 * 10;
+    bool reached[2][nodeCount] = {};
+    struct ChainNode { int16_t node; int8_t on, length; };
+    ChainNode queue[2 * nodeCount];
+    int queueHead = 0, queueTail = 0;
+
+    int startNode = cell * 10 + num;
+    reached[0][startNode] = true;
+    queue[queueTail++] = { int16_t(startNode), 0, 0 };
+    while (queueHead < queueTail)
+    {
+        const ChainNode chainNode(queue[queueHead++]);
+        int cell1 = chainNode.node / 10, num1 = chainNode.node % 10;
+        if (chainNode.on)
+        {
+            // (cell,num) and (cell1,num1) cannot both be false: remove what sees both
+            bool changed = false;
+            if (num1 == num)
+            {
+                Bitboard81 cells(state.numPossibilities[num]
+                                 & layout().peerBoards[cell]
+                                 & layout().peerBoards[cell1]);
+                if (cell1 == cell)
+                {
+                    // the start node has been reached "on" from itself, so it must be true
+                    for (int num2 = 1; num2 <= 9; num2++)
+                        if (num2 != num && cellHasPossibility(cell / 9, cell % 9, num2))
+                        {
+                            changed = true;
+                            setPossibility(cell / 9, cell % 9, num2, false);
+                        }
+                }
+                for (int cell2 = cells.takeFirst(); cell2 >= 0; cell2 = cells.takeFirst())
+                {
+                    changed = true;
+                    setPossibility(cell2 / 9, cell2 % 9, num, false);
+                }
+            }
+            else if (cell1 == cell)
+            {
+                for (int num2 = 1; num2 <= 9; num2++)
+                    if (num2 != num && num2 != num1 && cellHasPossibility(cell / 9, cell % 9, num2))
+                    {
+                        changed = true;
+                        setPossibility(cell / 9, cell % 9, num2, false);
+                    }
+            }
+            else if (layout().peerBoards[cell].test(cell1))
+            {
+                if (cellHasPossibility(cell / 9, cell % 9, num1))
+                {
+                    changed = true;
+                    setPossibility(cell / 9, cell % 9, num1, false);
+                }
+                if (cellHasPossibility(cell1 / 9, cell1 % 9, num))
+                {
+                    changed = true;
+                    setPossibility(cell1 / 9, cell1 % 9, num, false);
+                }
+            }
+            if (changed)
+                return true;
+        }
+        if (chainNode.length >= maxChainLength)
+            continue;
+
+        int8_t on = chainNode.on ? 0 : 1;
+        auto reach = [&](int cell2, int num2)
+        {
+            int node = cell2 * 10 + num2;
+            if (reached[on][node])
+                return;
+            reached[on][node] = true;
+            queue[queueTail++] = { int16_t(node), on, int8_t(chainNode.length + 1) };
+        };
+        if (chainNode.on)
+        {
+            // weak links: other numbers in the same cell, same number in cells which see this one
+            for (uint16_t mask = cellPossibilitiesMask(cell1) & ~(1 << num1); mask != 0; mask &= mask - 1)
+                reach(cell1, lowestBit64(mask));
+            Bitboard81 cells(state.numPossibilities[num1] & layout().peerBoards[cell1]);
+            for (int cell2 = cells.takeFirst(); cell2 >= 0; cell2 = cells.takeFirst())
+                reach(cell2, num1);
+        }
+        else
+        {
+            // strong links: other number in a bivalue cell, other cell of a conjugate pair
+            if (strongLinks.bivalueCells.test(cell1))
+                reach(cell1, lowestBit64(cellPossibilitiesMask(cell1) & ~(1 << num1)));
+            for (int slot = 0; slot < layout().cellUnitCounts[cell1]; slot++)
+                if (strongLinks.conjugates[num1][cell1][slot] >= 0)
+                    reach(strongLinks.conjugates[num1][cell1][slot], num1);
+        }
+    }
+    return false;
+}
+
+bool BoardSolver::reduceAllPossibilitiesForChains(const Deadline &deadline)
+{
+    // try chains from every possibility which has a strong link, until the step's time budget runs out
+    for (int cell = 0; cell < 81; cell++)
+        for (uint16_t mask = cellPossibilitiesMask(cell); mask != 0; mask &= mask - 1)
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            if (reducePossibilitiesForChainsFrom(cell, lowestBit64(mask)))
+                return true;
+        }
+    return false;
+}
+
+CellNum BoardSolver::solveFindStepPass4()
+{
+    // chains, tried only after everything else has failed
+    // after each reduction go back to looking for a move with the simpler passes
+    // (chains come last whatever the ordering, as they run until the deadline when they find nothing)
+    Deadline deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(_chainTimeBudget));
+    if (!strongLinks.valid)
+        strongLinks.build(state);
+    TechniqueStats::Technique techniques[] = { TechniqueStats::XYWings, TechniqueStats::SimpleColouring, TechniqueStats::Templates };
+    bool changed;
+    do
+    {
+        orderTechniques(techniques, 3);
+        changed = false;
+        for (int i = 0; i < 3 && !changed; i++)
+            changed = tryTechnique(techniques[i]);
+        if (!changed)
+            changed = reduceAllPossibilitiesForChains(deadline);
+        if (changed)
+        {
+            CellNum cellnum = solveFindStepPass1();
+            if (!cellnum.isEmpty())
+                return cellnum;
+            cellnum = solveFindStepPass2();
+            if (!cellnum.isEmpty())
+                return cellnum;
+            cellnum = solveFindStepPass3();
+            if (!cellnum.isEmpty())
+                return cellnum;
+        }
+    } while (changed && std::chrono::steady_clock::now() < deadline);
+    return CellNum();
+}
+
+void BoardSolver::startChainTechnique()
+{
+    // as at the start of `solveFindStepPass4()`, the first time a step gets to one of its techniques
+    if (!stepDeadlineSet)
+    {
+        stepDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_chainTimeBudget);
+        stepDeadlineSet = true;
+    }
+    if (!strongLinks.valid)
+        strongLinks.build(state);
+}
+
+bool BoardSolver::reduceAllPossibilitiesForChainsByStepDeadline()
+{
+    return reduceAllPossibilitiesForChains(stepDeadline);
+}
+
+bool BoardSolver::reducePossibilitiesForProbesOfCell(int row, int col)
+{
+    // "forcing chains": for a cell with just 2 possibilities, one of them must be true
+    // try each of them on a copy of the board, placing every single which follows from it
+    // if one leads to a contradiction the other must be true, so we can remove the first
+    // otherwise we can remove any possibility which has been removed in the outcomes of both
+    int cell = row * 9 + col;
+    uint16_t mask = cellPossibilitiesMask(cell);
+    int nums[2] = { lowestBit64(mask), lowestBit64(mask & (mask - 1)) };
+    BoardState outcomes[2];
+    bool consistent[2];
+    for (int i = 0; i < 2; i++)
+    {
+        outcomes[i] = state;
+        outcomes[i].setNumInCell(row, col, nums[i]);
+        outcomes[i].reducePossibilities(row, col);
+        consistent[i] = outcomes[i].propagateSingles();
+    }
+    if (!consistent[0] && !consistent[1])
+        return false;
+
+    bool changed = false;
+    if (!consistent[0] || !consistent[1])
+    {
+        setPossibility(row, col, nums[consistent[0] ? 1 : 0], false);
+        return true;
+    }
+    for (int cell2 = 0; cell2 < 81; cell2++)
+    {
+        if (state.nums[cell2] != 0)
+            continue;
+        uint16_t kept = 0;
+        for (int i = 0; i < 2; i++)
+            kept |= (outcomes[i].nums[cell2] != 0) ? (1 << outcomes[i].nums[cell2]) : outcomes[i].cellPossibilities[cell2];
+        for (uint16_t removed = cellPossibilitiesMask(cell2) & ~kept; removed != 0; removed &= removed - 1)
+        {
+            changed = true;
+            setPossibility(cell2 / 9, cell2 % 9, lowestBit64(removed), false);
+        }
+    }
+    return changed;
+}
+
+CellNum BoardSolver::solveFindStepPass5()
+{
+    // try out the possibilities of cells which have just 2, as the very last resort
+    // each try costs 2 "probes" on copies of the board, and a step may use up to `probeBudget()` of them
+    // after each reduction go back to looking for a move with the simpler passes
+    int probes = 0;
+    for (int cell = 0; cell < 81 && probes + 2 <= _probeBudget; cell++)
+    {
+        if (state.nums[cell] != 0 || bitCount64(cellPossibilitiesMask(cell)) != 2)
+            continue;
+        probes += 2;
+        if (!reducePossibilitiesForProbesOfCell(cell / 9, cell % 9))
+            continue;
+        CellNum cellnum = solveFindStepPass1();
+        if (!cellnum.isEmpty())
+            return cellnum;
+        cellnum = solveFindStepPass2();
+        if (!cellnum.isEmpty())
+            return cellnum;
+        cellnum = solveFindStepPass3();
+        if (!cellnum.isEmpty())
+            return cellnum;
+    }
+    return CellNum();
+}
+
+CellNum BoardSolver::solveFindStep()
+{
+    CellNum cellNum;
+    _lastStepPass = 1;
+    cellNum = solveFindStepPass1();
+    if (!cellNum.isEmpty())
+        return cellNum;
+    _lastStepPass = 2;
+    cellNum = solveFindStepPass2();
+    if (!cellNum.isEmpty())
+        return cellNum;
+    _lastStepPass = 3;
+    cellNum = solveFindStepPass3();
+    if (!cellNum.isEmpty())
+        return cellNum;
+    _lastStepPass = 4;
+    cellNum = solveFindStepPass4();
+    if (!cellNum.isEmpty())
+        return cellNum;
+    _lastStepPass = 5;
+    cellNum = solveFindStepPass5();
+    if (!cellNum.isEmpty())
+        return cellNum;
+    _lastStepPass = 0;
+    return CellNum();
+}
+
+int BoardSolver::lastStepPass() const
+{
+    // return which pass of `solveFindStep()` found the last step (0 if it found none)
+    // i.e. the hardest technique the step needed
+    return _lastStepPass;
+}
+
+int BoardSolver::solveFindWave(CellNum wave[81], bool hiddenSingles /*= true*/) const
+{
+    // find every single in the possibilities as they are now, a "wave" of steps none of which depends on another
+    // naked singles in the order `solveFindStepPass1()` finds them, then (if asked) hidden singles in `solveFindStepPass2()`'s
+    // a single clashing with one already found (in the same cell, or the same number in a group) is left out,
+    // as it means the board has a contradiction, which `applyWave()` then finds
+    // return how many singles there are in `wave`
+    int count = 0;
+    Bitboard81 taken;
+    Bitboard81 blocked[10];     // [num] -> cells seeing a cell in the wave with num
+    auto add = [&](int cell, int num)
+    {
+        if (taken.test(cell) || blocked[num].test(cell))
+            return;
+        taken.set(cell);
+        blocked[num] |= layout().peerBoards[cell];
+        wave[count++] = CellNum(cell / 9, cell % 9, num);
+    };
+    int num;
+    for (int cell = 0; cell < 81; cell++)
+        if (state.cellHasOnePossibility(cell / 9, cell % 9, num))
+            add(cell, num);
+    if (!hiddenSingles)
+        return count;
+    for (int i = 0; i < layout().unitCount; i++)
+    {
+        const Bitboard81 &groupCells(layout().unitBoards[unitColumnsFirst(i)]);
+        for (num = 1; num <= 9; num++)
+        {
+            Bitboard81 cells(state.numPossibilities[num] & groupCells);
+            if (cells.count() == 1)
+                add(cells.takeFirst(), num);
+        }
+    }
+    return count;
+}
+
+bool BoardSolver::applyWave(const CellNum wave[], int count)
+{
+    // place a wave of singles together, then reduce the possibilities of just the cells which see them
+    // return false if that has left a contradiction: a number twice in a group, an empty cell with no possibilities,
+    // or a number with nowhere to go in a group
+    for (int i = 0; i < count; i++)
+        placeNum(wave[i].row, wave[i].col, wave[i].num);
+    for (int i = 0; i < count; i++)
+        if (state.numInCellHasDuplicate(wave[i].row, wave[i].col))
+            return false;
+    if (state.checkForNoPossibilities())
+        return false;
+    for (int unit = 0; unit < layout().unitCount; unit++)
+    {
+        const uint8_t *cells = layout().unitCells[unit];
+        uint16_t covered = 0;
+        for (int index = 0; index < 9; index++)
+            covered |= cellPossibilitiesMask(cells[index]) | (1 << state.nums[cells[index]]);
+        if ((covered & 0x3fe) != 0x3fe)
+            return false;
+    }
+    return true;
+}
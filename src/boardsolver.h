@@ -0,0 +1,133 @@
+#ifndef BOARDSOLVER_H
+#define BOARDSOLVER_H
+
+#include <chrono>
+#include <cstdint>
+
+#include "boardlayout.h"
+#include "boardstate.h"
+
+template<class... Techniques> class SolverPipeline;
+
+////////// STRUCT TechniqueStats //////////
+// how often each of `BoardSolver`'s reduction techniques has been tried, how often it removed possibilities
+// and how long it took, from which a solver ordering its techniques adaptively puts the cheapest per hit first
+// a solver keeps its own, or several solvers in turn may share one (e.g. over a corpus), but not at once from several threads
+struct TechniqueStats
+{
+    enum Technique { IdenticalPairs, UniquePairs, RowColumnForSquares, XYWings, SimpleColouring, Templates, TechniqueCount };
+
+    uint64_t tries[TechniqueCount];
+    uint64_t hits[TechniqueCount];
+    uint64_t nsecs[TechniqueCount];
+
+    TechniqueStats() { clear(); }
+    void clear();
+    double costPerHit(Technique technique) const;
+};
+
+////////// CLASS BoardSolver //////////
+// finds the next certain move for a `BoardState` by logic alone, trying techniques from simplest to hardest
+// it has no Qt dependencies, so it can be used away from the GUI thread
+class BoardSolver
+{
+public:
+    BoardSolver();
+
+    BoardState state;
+
+    int chainTimeBudget() const;
+    void setChainTimeBudget(int msecs);
+    int probeBudget() const;
+    void setProbeBudget(int probes);
+    bool adaptiveOrdering() const;
+    void setAdaptiveOrdering(bool adaptive, TechniqueStats *sharedStats = nullptr);
+    const TechniqueStats &techniqueStats() const;
+
+    void resetAllPossibilities();
+    void reduceAllPossibilities();
+    void placeNum(int row, int col, int num);
+    CellNum solveFindStep();
+    int lastStepPass() const;
+    int solveFindWave(CellNum wave[81], bool hiddenSingles = true) const;
+    bool applyWave(const CellNum wave[], int count);
+
+    // the techniques as policies for `SolverPipeline` (see solverpipeline.h)
+    struct NakedSingles;
+    struct HiddenSingles;
+    struct IdenticalPairs;
+    struct UniquePairs;
+    struct RowColumnForSquares;
+    struct XYWings;
+    struct SimpleColouring;
+    struct Templates;
+    struct Chains;
+    struct Probes;
+
+private:
+    template<class... Techniques> friend class SolverPipeline;
+    typedef std::chrono::steady_clock::time_point Deadline;
+
+    struct StrongLinkGraph
+    {
+        // "strong links" between possibilities: if one of the pair is not true the other must be
+        // a cell with just 2 possibilities links those 2 numbers in the cell ("bivalue cell")
+        // a number possible in just 2 cells of a unit links the number in those 2 cells ("conjugate pair")
+        // built once per step and then kept up to date by `setPossibility()` as possibilities are removed
+        bool valid;
+        Bitboard81 bivalueCells;
+        int8_t conjugates[10][81][BoardLayout::MaxCellUnitCount];   // [num][cell][slot of unit in the cell's units] -> other cell of conjugate pair, or -1
+
+        StrongLinkGraph() { valid = false; }
+        void build(const BoardState &state);
+        void updateCell(const BoardState &state, int row, int col);
+        void updateUnit(const BoardState &state, int unit, int num);
+    };
+
+    StrongLinkGraph strongLinks;
+    int _chainTimeBudget;
+    int _probeBudget;
+    int _lastStepPass;
+    bool _adaptiveOrdering;
+    TechniqueStats ownStats;
+    TechniqueStats *sharedStats;
+    bool stepDeadlineSet;
+    Deadline stepDeadline;      // (for a `SolverPipeline`'s chain techniques, set when the first of them is reached in a step)
+
+    const BoardLayout &layout() const { return *state.layout; }
+    static int unitColumnsFirst(int i) { return (i < 18) ? (i + 9) % 18 : i; }     // (to go through the units columns, rows, boxes, extras)
+    int numInCell(int row, int col) const { return state.numInCell(row, col); }
+    bool cellHasPossibility(int row, int col, int num) const { return state.cellHasPossibility(row, col, num); }
+    uint16_t cellPossibilitiesMask(int cell) const { return state.cellPossibilities[cell]; }
+    void setPossibility(int row, int col, int num, bool possible);
+    CellNum solveFindStepPass1() const;
+    CellNum cellGroupOnlyPossibilityForNum(int unit) const;
+    CellNum solveFindStepPass2() const;
+    void cellGroupPossibilitiesByIndex(int unit, uint16_t groupPossibilities[9]) const;
+    bool reduceCellGroupPossibilitiesForIdenticalPairs(int unit);
+    bool reduceAllGroupPossibilitiesForIdenticalPairs();
+    uint16_t groupIndexPossibilitiesForNumber(int unit, int num) const;
+    void cellGroupPossibilitiesByNumber(int unit, uint16_t groupPossibilities[10]) const;
+    bool reduceCellGroupPossibilitiesForUniquePairs(int unit);
+    bool reduceAllGroupPossibilitiesForUniquePairs();
+    bool reduceRowColumnPossibilitiesForSquare(int param);
+    bool reduceAllRowColumnPossibilitiesForSquares();
+    bool reduceAllPossibilitiesFor(TechniqueStats::Technique technique);
+    bool tryTechnique(TechniqueStats::Technique technique);
+    void orderTechniques(TechniqueStats::Technique *techniques, int count) const;
+    CellNum solveFindStepPass3();
+    bool reduceAllPossibilitiesForXYWings();
+    bool reducePossibilitiesForSimpleColouring(int num);
+    bool reduceAllPossibilitiesForSimpleColouring();
+    bool reduceAllPossibilitiesForTemplates();
+    bool reducePossibilitiesForChainsFrom(int cell, int num);
+    bool reduceAllPossibilitiesForChains(const Deadline &deadline);
+    CellNum solveFindStepPass4();
+    bool reducePossibilitiesForProbesOfCell(int row, int col);
+    CellNum solveFindStepPass5();
+    void startChainTechnique();
+    bool reduceAllPossibilitiesForChainsByStepDeadline();
+    template<class Earlier, bool (BoardSolver::*Reduce)(), bool UntilDeadline> CellNum findStepByReducing();
+};
+
+#endif // BOARDSOLVER_H
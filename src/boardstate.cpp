@@ -0,0 +1,352 @@
+#include "boardlayout.h"
+#include "boardstate.h"
+
+
+////////// STRUCT CellGroupIterator //////////
+
+/*static*/ int CellGroupIterator::paramForDirection(CellGroupIteratorDirection direction, int row, int col)
+{
+    switch (direction)
+    {
+    case Row: return row;
+    case Column: return col;
+    case Square: return (row / 3) * 3 + (col / 3);
+    }
+    return -1;
+}
+
+/*static*/ int CellGroupIterator::groupIndexForDirection(CellGroupIteratorDirection direction, int row, int col)
+{
+    switch (direction)
+    {
+    case Row: return col;
+    case Column: return row;
+    case Square: return (row % 3) * 3 + (col % 3);
+    }
+    return -1;
+}
+
+/*static*/ const Bitboard81 &CellGroupIterator::groupBoard(CellGroupIteratorDirection direction, int param)
+{
+    // return the set of cells making up a "group" (row/column/square)
+    // cells in a group occur in ascending cell order in the same order as the group iterates them
+    struct GroupBoards
+    {
+        Bitboard81 boards[3][9];
+        GroupBoards()
+        {
+            for (CellGroupIteratorDirection direction : {Row, Column, Square})
+                for (int param = 0; param < 9; param++)
+                    for (CellGroupIterator cgit(direction, param); !cgit.atEnd(); cgit.next())
+                        boards[direction][param].set(cgit.row * 9 + cgit.col);
+        }
+    };
+    static const GroupBoards groupBoards;
+    return groupBoards.boards[direction][param];
+}
+
+/*static*/ const Bitboard81 &CellGroupIterator::peerBoard(int row, int col)
+{
+    // return the set of cells which "see" cell (row,col), i.e. share a row, column or square with it
+    struct PeerBoards
+    {
+        Bitboard81 boards[81];
+        PeerBoards()
+        {
+            for (int row = 0; row < 9; row++)
+                for (int col = 0; col < 9; col++)
+                {
+                    Bitboard81 &board(boards[row * 9 + col]);
+                    for (CellGroupIteratorDirection direction : {Row, Column, Square})
+                        board |= groupBoard(direction, paramForDirection(direction, row, col));
+                    board.clear(row * 9 + col);
+                }
+        }
+    };
+    static const PeerBoards peerBoards;
+    return peerBoards.boards[row * 9 + col];
+}
+
+/*static*/ const uint8_t *CellGroupIterator::groupCells(CellGroupIteratorDirection direction, int param)
+{
+    // return the 9 cells making up a "group" (row/column/square), in the order the group iterates them
+    struct GroupCells
+    {
+        uint8_t cells[3][9][9];
+        GroupCells()
+        {
+            for (CellGroupIteratorDirection direction : {Row, Column, Square})
+                for (int param = 0; param < 9; param++)
+                    for (CellGroupIterator cgit(direction, param); !cgit.atEnd(); cgit.next())
+                        cells[direction][param][cgit.groupIndex] = uint8_t(cgit.row * 9 + cgit.col);
+        }
+    };
+    static const GroupCells groupCells;
+    return groupCells.cells[direction][param];
+}
+
+/*static*/ void CellGroupIterator::rowColForIndexInSquare(int index, int square, int &row, int &col)
+{
+    row = square / 3 * 3 + index / 3;
+    col = square % 3 * 3 + index % 3;
+}
+
+CellGroupIterator::CellGroupIterator(CellGroupIteratorDirection direction, int param)
+{
+    this->direction = direction;
+    row0 = col0 = groupIndex = 0;
+    switch (direction)
+    {
+    case Row: row0 = param; break;
+    case Column: col0 = param; break;
+    case Square:
+        row0 = param / 3 * 3;
+        col0 = param % 3 * 3;
+        break;
+    }
+    row = row0;
+    col = col0;
+}
+
+CellGroupIterator::CellGroupIterator(CellGroupIteratorDirection direction, int row, int col)
+    : CellGroupIterator(direction, paramForDirection(direction, row, col))
+{
+}
+
+bool CellGroupIterator::atEnd() const
+{
+    switch (direction)
+    {
+    case Row: return (col >= 9);
+    case Column: return (row >= 9);
+    case Square: return (row >= row0 + 3 || (row == row0 + 2 && col >= col0 + 3));
+    }
+    return true;
+}
+
+bool CellGroupIterator::next()
+{
+    if (atEnd())
+        return false;
+    groupIndex++;
+    switch (direction)
+    {
+    case Row: col++; break;
+    case Column: row++; break;
+    case Square:
+        if (++col >= col0 + 3)
+        {
+            col = col0;
+            row++;
+        }
+        break;
+    }
+    return true;
+}
+
+
+
+////////// STRUCT BoardState //////////
+
+BoardState::BoardState()
+{
+    layout = &BoardLayout::standard();
+    clear();
+}
+
+void BoardState::clear()
+{
+    for (int cell = 0; cell < 81; cell++)
+        nums[cell] = 0;
+    resetAllPossibilities();
+}
+
+void BoardState::pack(uint8_t packed[PackedSize]) const
+{
+    // the numbers 2 to a byte, in its high and low 4 bits (the last low 4 bits are 0)
+    for (int cell = 0; cell < 81; cell += 2)
+        packed[cell / 2] = uint8_t((nums[cell] << 4) | ((cell + 1 < 81) ? nums[cell + 1] : 0));
+}
+
+void BoardState::unpack(const uint8_t packed[PackedSize])
+{
+    // (numbers out of range are taken as empty)
+    for (int cell = 0; cell < 81; cell++)
+    {
+        int num = (cell % 2 == 0) ? packed[cell / 2] >> 4 : packed[cell / 2] & 0xf;
+        nums[cell] = uint8_t((num <= 9) ? num : 0);
+    }
+    resetAllPossibilities();
+}
+
+bool BoardState::setPossibility(int row, int col, int num, bool possible)
+{
+    // return whether the possibility changed
+    if (cellHasPossibility(row, col, num) == possible)
+        return false;
+    int cell = row * 9 + col;
+    if (possible)
+    {
+        cellPossibilities[cell] |= (1 << num);
+        numPossibilities[num].set(cell);
+    }
+    else
+    {
+        cellPossibilities[cell] &= ~(1 << num);
+        numPossibilities[num].clear(cell);
+    }
+    return true;
+}
+
+void BoardState::resetAllPossibilities()
+{
+    for (int cell = 0; cell < 81; cell++)
+        cellPossibilities[cell] = 0x3fe;
+    numPossibilities[0] = Bitboard81();
+    for (int num = 1; num <= 9; num++)
+        numPossibilities[num] = Bitboard81::all();
+}
+
+void BoardState::setAllPossibilities(const uint16_t possibilities[81])
+{
+    // set the possibilities of every cell at once (e.g. as saved earlier), filling in the number-major copy to match
+    for (int num = 0; num <= 9; num++)
+        numPossibilities[num] = Bitboard81();
+    for (int cell = 0; cell < 81; cell++)
+    {
+        cellPossibilities[cell] = possibilities[cell] & 0x3fe;
+        for (uint16_t mask = cellPossibilities[cell]; mask != 0; mask &= mask - 1)
+            numPossibilities[lowestBit64(mask)].set(cell);
+    }
+}
+
+void BoardState::reducePossibilities(int row, int col)
+{
+    // remove all possibilities from an occupied cell, and its number from the possibilities of cells which see it
+    int numHere = numInCell(row, col);
+    if (numHere == 0)
+        return;
+    int cell = row * 9 + col;
+    for (uint16_t mask = cellPossibilities[cell]; mask != 0; mask &= mask - 1)
+        numPossibilities[lowestBit64(mask)].clear(cell);
+    cellPossibilities[cell] = 0;
+    Bitboard81 cells(numPossibilities[numHere] & layout->peerBoards[cell]);
+    numPossibilities[numHere] &= ~cells;
+    for (int cell2 = cells.takeFirst(); cell2 >= 0; cell2 = cells.takeFirst())
+        cellPossibilities[cell2] &= ~(1 << numHere);
+}
+
+void BoardState::reduceAllPossibilities()
+{
+    for (int row = 0; row < 9; row++)
+        for (int col = 0; col < 9; col++)
+            reducePossibilities(row, col);
+}
+
+bool BoardState::isSolved() const
+{
+    for (int cell = 0; cell < 81; cell++)
+        if (nums[cell] == 0)
+            return false;
+    return true;
+}
+
+bool BoardState::numInCellHasDuplicate(int row, int col) const
+{
+    int num = numInCell(row, col);
+    if (num == 0)
+        return false;
+    Bitboard81 cells(layout->peerBoards[row * 9 + col]);
+    for (int cell = cells.takeFirst(); cell >= 0; cell = cells.takeFirst())
+        if (nums[cell] == num)
+            return true;
+    return false;
+}
+
+bool BoardState::checkForDuplicates() const
+{
+    for (int row = 0; row < 9; row++)
+        for (int col = 0; col < 9; col++)
+            if (numInCellHasDuplicate(row, col))
+                return true;
+    return false;
+}
+
+bool BoardState::checkForNoPossibilities() const
+{
+    for (int cell = 0; cell < 81; cell++)
+        if (nums[cell] == 0 && cellPossibilities[cell] == 0)
+            return true;
+    return false;
+}
+
+bool BoardState::cellHasOnePossibility(int row, int col, int &num) const
+{
+    num = 0;
+    uint16_t mask = cellPossibilities[row * 9 + col];
+    if (mask == 0 || (mask & (mask - 1)) != 0)
+        return false;
+    if (numInCell(row, col) != 0)
+        return false;
+    num = lowestBit64(mask);
+    return true;
+}
+
+bool BoardState::propagateSingles()
+{
+    // (possibilities must already have been reduced)
+    // repeatedly place the number in any cell which has just 1 possibility ("naked single")
+    // and any number which is possible in just 1 cell of a group ("hidden single")
+    // return false if that leads to a contradiction:
+    // an empty cell with no possibilities, or a number with nowhere to go in a group
+    bool changed;
+    do
+    {
+        changed = false;
+        for (int cell = 0; cell < 81; cell++)
+        {
+            if (nums[cell] != 0)
+                continue;
+            uint16_t mask = cellPossibilities[cell];
+            if (mask == 0)
+                return false;
+            if ((mask & (mask - 1)) == 0)
+            {
+                nums[cell] = uint8_t(lowestBit64(mask));
+                reducePossibilities(cell / 9, cell % 9);
+                changed = true;
+            }
+        }
+        for (int unit = 0; unit < layout->unitCount; unit++)
+        {
+            const uint8_t *cells = layout->unitCells[unit];
+            uint16_t placed = 0, once = 0, twice = 0;
+            for (int index = 0; index < 9; index++)
+            {
+                uint16_t mask = cellPossibilities[cells[index]];
+                placed |= (1 << nums[cells[index]]);
+                twice |= once & mask;
+                once |= mask;
+            }
+            if (((placed | once) & 0x3fe) != 0x3fe)
+                return false;
+            uint16_t onlyOnce = once & ~twice & ~placed;
+            if (onlyOnce == 0)
+                continue;
+            for (int index = 0; index < 9; index++)
+            {
+                int cell = cells[index];
+                uint16_t mask = cellPossibilities[cell] & onlyOnce;
+                if (mask == 0)
+                    continue;
+                if ((mask & (mask - 1)) != 0)
+                    return false;
+                nums[cell] = uint8_t(lowestBit64(mask));
+                reducePossibilities(cell / 9, cell % 9);
+                onlyOnce &= ~mask;
+                changed = true;
+            }
+        }
+    } while (changed);
+    return true;
+}
@@ -0,0 +1,90 @@
+#ifndef BOARDSTATE_H
+#define BOARDSTATE_H
+
+#include <cstdint>
+#include <initializer_list>
+
+#include "bitboard.h"
+
+struct BoardLayout;
+
+struct CellNum
+{
+    int row, col;
+    int num;
+
+    CellNum() { row = col = num = 0; }
+    CellNum(int row, int col, int num)
+    {
+        this->row = row;
+        this->col = col;
+        this->num = num;
+    }
+    bool isEmpty() const { return (num == 0); };
+};
+
+
+////////// STRUCT CellGroupIterator //////////
+
+enum CellGroupIteratorDirection { Row, Column, Square };
+
+struct CellGroupIterator
+{
+    CellGroupIteratorDirection direction;
+    int row0, col0;
+    int row, col;
+    int groupIndex;
+
+    static int paramForDirection(CellGroupIteratorDirection direction, int row, int col);
+    static int groupIndexForDirection(CellGroupIteratorDirection direction, int row, int col);
+    static const Bitboard81 &groupBoard(CellGroupIteratorDirection direction, int param);
+    static const Bitboard81 &peerBoard(int row, int col);
+    static const uint8_t *groupCells(CellGroupIteratorDirection direction, int param);
+    static void rowColForIndexInSquare(int index, int square, int &row, int &col);
+    CellGroupIterator(CellGroupIteratorDirection direction, int param);
+    CellGroupIterator(CellGroupIteratorDirection direction, int row, int col);
+    bool atEnd() const;
+    bool next();
+};
+
+
+////////// STRUCT BoardState //////////
+// the whole solving state of a board as a plain value: the number in each cell and the possibilities
+// it is a few hundred bytes with no pointers but one to its (shared, unchanging) layout, so it can be copied freely
+// (e.g. to try a move out on the stack)
+struct BoardState
+{
+    // possibilities are held twice, kept in step by `setPossibility()`
+    // cell-major: bit `num` of `cellPossibilities[cell]` is set if num is possible in cell
+    // number-major: bit `cell` of `numPossibilities[num]` is set if num is possible in cell
+    // (cell = row * 9 + col)
+    uint8_t nums[81];
+    uint16_t cellPossibilities[81];
+    Bitboard81 numPossibilities[10];
+    const BoardLayout *layout;      // the standard board unless set otherwise
+
+    enum { PackedSize = 41 };
+
+    BoardState();
+    void clear();
+    void pack(uint8_t packed[PackedSize]) const;
+    void unpack(const uint8_t packed[PackedSize]);
+
+    int numInCell(int row, int col) const { return nums[row * 9 + col]; }
+    void setNumInCell(int row, int col, int num) { nums[row * 9 + col] = uint8_t(num); }
+    bool cellHasPossibility(int row, int col, int num) const { return (cellPossibilities[row * 9 + col] & (1 << num)) != 0; }
+    bool setPossibility(int row, int col, int num, bool possible);
+    void resetAllPossibilities();
+    void setAllPossibilities(const uint16_t possibilities[81]);
+    void reducePossibilities(int row, int col);
+    void reduceAllPossibilities();
+
+    bool isSolved() const;
+    bool numInCellHasDuplicate(int row, int col) const;
+    bool checkForDuplicates() const;
+    bool checkForNoPossibilities() const;
+    bool cellHasOnePossibility(int row, int col, int &num) const;
+    bool propagateSingles();
+};
+
+#endif // BOARDSTATE_H
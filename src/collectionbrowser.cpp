@@ -0,0 +1,453 @@
+#include <QHeaderView>
+#include <QPainter>
+#include <QPixmapCache>
+#include <QScrollBar>
+#include <QVBoxLayout>
+
+#include <algorithm>
+#include <climits>
+
+#include "collectionbrowser.h"
+
+
+////////// CLASS PuzzleCollectionModel //////////
+
+// records put through the tier filter on each tick of the progress timer, so that filtering millions never holds up the GUI
+static const size_t filterScanPerTick = 200000;
+
+static uint32_t packGrade(const BoardGrader::Grade &grade)
+{
+    if (!grade.hasOneSolution())
+        return (uint32_t(BoardGrader::TierCount + 1) << 16) | uint32_t(grade.solutionCount);
+    return (uint32_t(grade.tier() + 1) << 16) | uint32_t(std::min(grade.rating, 0xffff));
+}
+
+PuzzleCollectionModel::PuzzleCollectionModel(QObject *parent /*= nullptr*/)
+    : QAbstractTableModel(parent)
+{
+    stopGraders = false;
+    nextToGrade = 0;
+    visibleFirst = visibleEnd = 0;
+    gradedTotal = 0;
+    gradedPrefix = shownGradedTotal = 0;
+    _tierFilter = AllTiers;
+    filterScanned = 0;
+    progressTimer.setInterval(200);
+    connect(&progressTimer, &QTimer::timeout, this, &PuzzleCollectionModel::progressTimeout);
+}
+
+PuzzleCollectionModel::~PuzzleCollectionModel()
+{
+    stopGrading();
+}
+
+void PuzzleCollectionModel::open(const QString &filePath)
+{
+    // throw `std::runtime_error` if the file cannot be opened or is not a corpus, leaving the model empty
+    beginResetModel();
+    stopGrading();
+    progressTimer.stop();
+    grades.reset();
+    filteredRecords.clear();
+    filterScanned = 0;
+    visibleFirst = visibleEnd = 0;
+    gradedTotal = 0;
+    _filePath.clear();
+    try {
+        reader.open(filePath.toStdString());
+    } catch (const std::exception &e) {
+        gradedPrefix = shownGradedTotal = 0;
+        endResetModel();
+        throw;
+    }
+    _filePath = filePath;
+    if (reader.flags() & CorpusHasGrades)
+        gradedPrefix = reader.size();
+    else
+    {
+        grades.reset(new std::atomic<uint32_t>[reader.size()]());
+        gradedPrefix = 0;
+    }
+    shownGradedTotal = gradedCount();
+    endResetModel();
+    startGrading();
+    progressTimer.start();
+}
+
+void PuzzleCollectionModel::close()
+{
+    beginResetModel();
+    stopGrading();
+    progressTimer.stop();
+    reader.close();
+    grades.reset();
+    filteredRecords.clear();
+    filterScanned = gradedPrefix = shownGradedTotal = 0;
+    gradedTotal = 0;
+    _filePath.clear();
+    endResetModel();
+}
+
+size_t PuzzleCollectionModel::gradedCount() const
+{
+    return grades ? gradedTotal.load(std::memory_order_relaxed) : reader.size();
+}
+
+void PuzzleCollectionModel::setTierFilter(int tier)
+{
+    // the filtered rows come back as the progress timer puts the graded records through the filter
+    if (tier == _tierFilter)
+        return;
+    beginResetModel();
+    _tierFilter = tier;
+    filteredRecords.clear();
+    filterScanned = 0;
+    endResetModel();
+    scanFilter(filterScanPerTick);
+    if (!_filePath.isEmpty())
+        progressTimer.start();
+}
+
+void PuzzleCollectionModel::setVisibleRows(int first, int last)
+{
+    // the rows on view, whose records the graders take first
+    // (with a filter the rows on view are graded already)
+    if (!grades || _tierFilter != AllTiers || first < 0 || last < first)
+    {
+        visibleFirst = visibleEnd = 0;
+        return;
+    }
+    visibleFirst = std::min(size_t(first), reader.size());
+    visibleEnd = std::min(size_t(last) + 1, reader.size());
+}
+
+size_t PuzzleCollectionModel::recordIndex(int row) const
+{
+    return (_tierFilter == AllTiers) ? size_t(row) : filteredRecords[size_t(row)];
+}
+
+void PuzzleCollectionModel::puzzle(int row, BoardState &state) const
+{
+    state = BoardState();
+    reader.record(recordIndex(row)).puzzle(state);
+}
+
+void PuzzleCollectionModel::startGrading()
+{
+    // one thread fewer than the cores, leaving one for the GUI
+    if (!grades || reader.size() == 0)
+        return;
+    stopGraders = false;
+    nextToGrade = 0;
+    unsigned threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    for (unsigned i = 0; i < threadCount; i++)
+        graders.emplace_back(&PuzzleCollectionModel::graderThread, this);
+}
+
+void PuzzleCollectionModel::stopGrading()
+{
+    // (each thread stops after the puzzle it is grading)
+    stopGraders = true;
+    for (std::thread &grader : graders)
+        grader.join();
+    graders.clear();
+}
+
+void PuzzleCollectionModel::graderThread()
+{
+    // (as `--to-corpus --with-grades` does, without the adaptive technique order, so the grades match a graded corpus)
+    BoardState puzzle;
+    BoardGrader::Grade grade;
+    size_t index;
+    while (claimRecord(index))
+    {
+        reader.record(index).puzzle(puzzle);
+        BoardGrader::grade(puzzle, grade);
+        grades[index].store(packGrade(grade), std::memory_order_release);
+        gradedTotal.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool PuzzleCollectionModel::claimRecord(size_t &index)
+{
+    // the first record on view not yet claimed, or else the next in order not yet claimed
+    // return false when every record has been claimed, or grading is to stop
+    for (;;)
+    {
+        if (stopGraders.load(std::memory_order_relaxed))
+            return false;
+        size_t first = visibleFirst.load(std::memory_order_relaxed), end = visibleEnd.load(std::memory_order_relaxed);
+        for (index = first; index < end; index++)
+        {
+            uint32_t expected = Ungraded;
+            if (grades[index].load(std::memory_order_relaxed) == Ungraded && grades[index].compare_exchange_strong(expected, Claimed))
+                return true;
+        }
+        index = nextToGrade.fetch_add(1, std::memory_order_relaxed);
+        if (index >= reader.size())
+            return false;
+        uint32_t expected = Ungraded;
+        if (grades[index].compare_exchange_strong(expected, Claimed))
+            return true;
+    }
+}
+
+uint32_t PuzzleCollectionModel::packedGrade(size_t index) const
+{
+    // a record's grade as in `grades`, `Ungraded` while it is not graded yet
+    if (!grades)
+    {
+        BoardGrader::Grade grade;
+        return reader.record(index).grade(grade) ? packGrade(grade) : uint32_t(Ungraded);
+    }
+    uint32_t packed = grades[index].load(std::memory_order_acquire);
+    return (packed == Claimed) ? uint32_t(Ungraded) : packed;
+}
+
+void PuzzleCollectionModel::scanFilter(size_t limit)
+{
+    // put up to `limit` more of the graded records through the tier filter, adding the rows of those in its tier
+    if (_tierFilter == AllTiers)
+        return;
+    size_t end = std::min(gradedPrefix, filterScanned + limit);
+    std::vector<uint32_t> matches;
+    for (size_t index = filterScanned; index < end; index++)
+        if (int(packedGrade(index) >> 16) - 1 == _tierFilter)
+            matches.push_back(uint32_t(index));
+    filterScanned = end;
+    if (matches.empty())
+        return;
+    beginInsertRows(QModelIndex(), int(filteredRecords.size()), int(filteredRecords.size() + matches.size() - 1));
+    filteredRecords.insert(filteredRecords.end(), matches.begin(), matches.end());
+    endInsertRows();
+}
+
+/*slot*/ void PuzzleCollectionModel::progressTimeout()
+{
+    // the grades come in out of order, so rather than a signal for each, every tick repaints the grade columns
+    // and the filter takes the records graded all the way from the start
+    size_t graded = gradedCount();
+    if (graded != shownGradedTotal)
+    {
+        shownGradedTotal = graded;
+        if (_tierFilter == AllTiers && rowCount() > 0)
+            emit dataChanged(index(0, TierColumn), index(rowCount() - 1, RatingColumn));
+    }
+    while (gradedPrefix < reader.size() && packedGrade(gradedPrefix) != Ungraded)
+        gradedPrefix++;
+    scanFilter(filterScanPerTick);
+    emit gradingProgress();
+    if (gradedPrefix == reader.size() && (_tierFilter == AllTiers || filterScanned == reader.size()))
+    {
+        progressTimer.stop();
+        stopGrading();
+    }
+}
+
+/*virtual*/ int PuzzleCollectionModel::rowCount(const QModelIndex &parent /*= QModelIndex()*/) const /*override*/
+{
+    // (a view takes no more than `INT_MAX` rows)
+    if (parent.isValid())
+        return 0;
+    if (_tierFilter != AllTiers)
+        return int(filteredRecords.size());
+    return int(std::min(reader.size(), size_t(INT_MAX)));
+}
+
+/*virtual*/ int PuzzleCollectionModel::columnCount(const QModelIndex &parent /*= QModelIndex()*/) const /*override*/
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+/*virtual*/ QVariant PuzzleCollectionModel::data(const QModelIndex &index, int role /*= Qt::DisplayRole*/) const /*override*/
+{
+    // a row's record is only read from the corpus when the view asks for it
+    if (!index.isValid())
+        return QVariant();
+    if (role == Qt::TextAlignmentRole)
+        return (index.column() == TierColumn || index.column() == PuzzleColumn) ? int(Qt::AlignLeft | Qt::AlignVCenter) : int(Qt::AlignRight | Qt::AlignVCenter);
+    if (role != Qt::DisplayRole && !(role == Qt::ToolTipRole && index.column() == PuzzleColumn))
+        return QVariant();
+    size_t record = recordIndex(index.row());
+    switch (index.column())
+    {
+    case NumberColumn:
+        return qulonglong(record + 1);
+    case PuzzleColumn:
+    case GivensColumn: {
+        char text[81];
+        reader.record(record).puzzleText(text);
+        if (index.column() == PuzzleColumn)
+            return QString::fromLatin1(text, 81);
+        return int(81 - std::count(text, text + 81, '0'));
+    }
+    case TierColumn: {
+        uint32_t packed = packedGrade(record);
+        if (packed == Ungraded)
+            return QVariant();
+        int tier = int(packed >> 16) - 1;
+        if (tier == BoardGrader::TierCount)
+            return QString(BoardGrader::solutionCountName(int(packed & 0xffff)));
+        return QString(BoardGrader::tierName(BoardGrader::Tier(tier)));
+    }
+    case RatingColumn: {
+        uint32_t packed = packedGrade(record);
+        if (packed == Ungraded || int(packed >> 16) - 1 == BoardGrader::TierCount)
+            return QVariant();
+        return int(packed & 0xffff);
+    }
+    }
+    return QVariant();
+}
+
+/*virtual*/ QVariant PuzzleCollectionModel::headerData(int section, Qt::Orientation orientation, int role /*= Qt::DisplayRole*/) const /*override*/
+{
+    static const char *const columnNames[ColumnCount] = { "#", "Puzzle", "Givens", "Grade", "Rating" };
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole || section < 0 || section >= ColumnCount)
+        return QAbstractTableModel::headerData(section, orientation, role);
+    return QString(columnNames[section]);
+}
+
+
+////////// CLASS PuzzleThumbnailDelegate //////////
+
+PuzzleThumbnailDelegate::PuzzleThumbnailDelegate(QObject *parent /*= nullptr*/)
+    : QStyledItemDelegate(parent)
+{
+}
+
+/*virtual*/ void PuzzleThumbnailDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const /*override*/
+{
+    if (index.column() != PuzzleCollectionModel::PuzzleColumn)
+    {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+    // the picture is keyed by the puzzle itself, so it is drawn once however the rows move about
+    QByteArray text(index.data().toString().toLatin1());
+    QString key("thumbnail:" + QString::fromLatin1(text));
+    QPixmap pixmap;
+    if (!QPixmapCache::find(key, &pixmap))
+    {
+        pixmap = QPixmap(Size, Size);
+        pixmap.fill(Qt::white);
+        QPainter pixmapPainter(&pixmap);
+        for (int cell = 0; cell < 81 && cell < text.size(); cell++)
+            if (text.at(cell) != '0')
+                pixmapPainter.fillRect((cell % 9) * CellSize + 1, (cell / 9) * CellSize + 1, CellSize - 1, CellSize - 1, Qt::darkGray);
+        for (int line = 0; line <= 9; line++)
+        {
+            pixmapPainter.setPen((line % 3 == 0) ? Qt::black : Qt::lightGray);
+            pixmapPainter.drawLine(line * CellSize, 0, line * CellSize, Size - 1);
+            pixmapPainter.drawLine(0, line * CellSize, Size - 1, line * CellSize);
+        }
+        pixmapPainter.end();
+        QPixmapCache::insert(key, pixmap);
+    }
+    if (option.state & QStyle::State_Selected)
+        painter->fillRect(option.rect, option.palette.highlight());
+    painter->drawPixmap(option.rect.x() + (option.rect.width() - Size) / 2, option.rect.y() + (option.rect.height() - Size) / 2, pixmap);
+}
+
+/*virtual*/ QSize PuzzleThumbnailDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const /*override*/
+{
+    if (index.column() != PuzzleCollectionModel::PuzzleColumn)
+        return QStyledItemDelegate::sizeHint(option, index);
+    return QSize(Size + 4, Size + 4);
+}
+
+
+////////// CLASS CollectionBrowser //////////
+
+CollectionBrowser::CollectionBrowser(QWidget *parent /*= nullptr*/)
+    : QWidget(parent)
+{
+    model = new PuzzleCollectionModel(this);
+
+    tierCombo = new QComboBox(this);
+    tierCombo->addItem("All grades", int(PuzzleCollectionModel::AllTiers));
+    for (int tier = 0; tier < BoardGrader::TierCount; tier++)
+        tierCombo->addItem(BoardGrader::tierName(BoardGrader::Tier(tier)), tier);
+    connect(tierCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &CollectionBrowser::tierComboChanged);
+
+    // every row is the same height and every column a set width, so that the view never measures millions of rows
+    tableView = new QTableView(this);
+    tableView->setModel(model);
+    tableView->setItemDelegate(new PuzzleThumbnailDelegate(tableView));
+    tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    tableView->setSelectionMode(QAbstractItemView::SingleSelection);
+    tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    tableView->verticalHeader()->hide();
+    tableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    tableView->verticalHeader()->setDefaultSectionSize(PuzzleThumbnailDelegate::Size + 4);
+    tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    tableView->setColumnWidth(PuzzleCollectionModel::NumberColumn, 80);
+    tableView->setColumnWidth(PuzzleCollectionModel::PuzzleColumn, PuzzleThumbnailDelegate::Size + 8);
+    tableView->setColumnWidth(PuzzleCollectionModel::GivensColumn, 50);
+    tableView->setColumnWidth(PuzzleCollectionModel::TierColumn, 80);
+    tableView->setColumnWidth(PuzzleCollectionModel::RatingColumn, 50);
+    connect(tableView, &QAbstractItemView::activated, this, &CollectionBrowser::rowActivated);
+    connect(tableView->verticalScrollBar(), &QScrollBar::valueChanged, [this]() { updateVisibleRows(); });
+
+    statusLabel = new QLabel(this);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(tierCombo);
+    layout->addWidget(tableView);
+    layout->addWidget(statusLabel);
+
+    // (the rows on view are also passed on with each report of progress, which catches the panel being resized)
+    connect(model, &PuzzleCollectionModel::gradingProgress, [this]() { updateStatus(); updateVisibleRows(); });
+}
+
+void CollectionBrowser::openCollection(const QString &filePath)
+{
+    // throw `std::runtime_error` if the file cannot be opened or is not a corpus
+    try {
+        model->open(filePath);
+    } catch (const std::exception &e) {
+        updateStatus();
+        throw;
+    }
+    tableView->scrollToTop();
+    updateStatus();
+    updateVisibleRows();
+}
+
+void CollectionBrowser::updateVisibleRows()
+{
+    int first = tableView->rowAt(0);
+    int last = tableView->rowAt(tableView->viewport()->height() - 1);
+    if (first >= 0 && last < 0)
+        last = model->rowCount() - 1;
+    model->setVisibleRows(first, last);
+}
+
+void CollectionBrowser::updateStatus()
+{
+    // e.g. "1000000 puzzles, 23456 graded, 812 shown"
+    if (model->filePath().isEmpty())
+    {
+        statusLabel->clear();
+        return;
+    }
+    QString status(QString("%1 puzzles, %2 graded").arg(qulonglong(model->recordCount())).arg(qulonglong(model->gradedCount())));
+    if (model->tierFilter() != PuzzleCollectionModel::AllTiers)
+        status += QString(", %1 shown").arg(model->rowCount());
+    statusLabel->setText(status);
+}
+
+/*slot*/ void CollectionBrowser::tierComboChanged(int comboIndex)
+{
+    model->setTierFilter(tierCombo->itemData(comboIndex).toInt());
+    updateStatus();
+    updateVisibleRows();
+}
+
+/*slot*/ void CollectionBrowser::rowActivated(const QModelIndex &index)
+{
+    // (reading one record from the mapped file, so the puzzle opens at once)
+    BoardState puzzle;
+    model->puzzle(index.row(), puzzle);
+    emit puzzleActivated(puzzle);
+}
@@ -0,0 +1,137 @@
+#ifndef COLLECTIONBROWSER_H
+#define COLLECTIONBROWSER_H
+
+#include <QAbstractTableModel>
+#include <QComboBox>
+#include <QLabel>
+#include <QStyledItemDelegate>
+#include <QTableView>
+#include <QTimer>
+#include <QWidget>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "boardgrader.h"
+#include "puzzlecorpus.h"
+
+////////// CLASS PuzzleCollectionModel //////////
+// a corpus file of puzzles, possibly millions, as a table of their numbers, thumbnails, givens and grades
+// the file is mapped by `PuzzleCorpusReader` and nothing is read from it until a row is asked for, so opening it is instant
+// a corpus without grades is graded by background threads, the rows on view first and then the rest in order,
+// and the grade columns fill in as they go
+// a tier filter shows the rows in that tier as far as they have been graded, adding more as the grading gets further
+class PuzzleCollectionModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column { NumberColumn, PuzzleColumn, GivensColumn, TierColumn, RatingColumn, ColumnCount };
+    enum { AllTiers = -1 };
+
+    PuzzleCollectionModel(QObject *parent = nullptr);
+    ~PuzzleCollectionModel();
+
+    void open(const QString &filePath);
+    void close();
+    const QString &filePath() const { return _filePath; }
+    size_t recordCount() const { return reader.size(); }
+    size_t gradedCount() const;
+    int tierFilter() const { return _tierFilter; }
+    void setTierFilter(int tier);
+    void setVisibleRows(int first, int last);
+    size_t recordIndex(int row) const;
+    void puzzle(int row, BoardState &state) const;
+
+    virtual int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    virtual int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    // a record's grade as one word: 0 until it is graded, `Claimed` while a thread grades it,
+    // then the tier + 1 in the top half and the rating in the bottom
+    // (or for a puzzle without just one solution `TierCount` + 1 and its solution count, 0 or 2, so no tier filter takes it)
+    enum : uint32_t { Ungraded = 0, Claimed = 1 };
+
+    PuzzleCorpusReader reader;
+    QString _filePath;
+    std::unique_ptr<std::atomic<uint32_t>[]> grades;    // [record], for a corpus without grades
+    std::vector<std::thread> graders;
+    std::atomic<bool> stopGraders;
+    std::atomic<size_t> nextToGrade;                    // the next record to grade in order
+    std::atomic<size_t> visibleFirst, visibleEnd;       // the records on view, to grade first
+    std::atomic<size_t> gradedTotal;
+    QTimer progressTimer;
+    size_t gradedPrefix;                                // the records before this are all graded
+    size_t shownGradedTotal;
+    int _tierFilter;
+    std::vector<uint32_t> filteredRecords;              // the records with the filter's tier, in order
+    size_t filterScanned;                               // the records before this have been through the filter
+
+    void startGrading();
+    void stopGrading();
+    void graderThread();
+    bool claimRecord(size_t &index);
+    uint32_t packedGrade(size_t index) const;
+    void scanFilter(size_t limit);
+
+signals:
+    void gradingProgress();
+
+private slots:
+    void progressTimeout();
+};
+
+
+////////// CLASS PuzzleThumbnailDelegate //////////
+// draws a puzzle's column as a small picture of the board, its givens as dark squares
+// it is only asked to paint the rows on view, and keeps the pictures in `QPixmapCache` for scrolling back
+class PuzzleThumbnailDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    enum { CellSize = 6, Size = 9 * CellSize + 1 };
+
+    PuzzleThumbnailDelegate(QObject *parent = nullptr);
+
+    virtual void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    virtual QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+};
+
+
+////////// CLASS CollectionBrowser //////////
+// the collection panel beside the board: a tier filter, the table of puzzles and how far the grading has got
+// activating a row (double-click or Enter) opens that puzzle on the board
+class CollectionBrowser : public QWidget
+{
+    Q_OBJECT
+
+public:
+    CollectionBrowser(QWidget *parent = nullptr);
+
+    void openCollection(const QString &filePath);
+    const QString &filePath() const { return model->filePath(); }
+
+private:
+    PuzzleCollectionModel *model;
+    QComboBox *tierCombo;
+    QTableView *tableView;
+    QLabel *statusLabel;
+
+    void updateVisibleRows();
+    void updateStatus();
+
+signals:
+    void puzzleActivated(const BoardState &puzzle);
+
+private slots:
+    void tierComboChanged(int comboIndex);
+    void rowActivated(const QModelIndex &index);
+};
+
+#endif // COLLECTIONBROWSER_H
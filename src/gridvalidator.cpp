@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cstring>
+
+#include "gridvalidator.h"
+
+
+////////// CLASS GridValidator //////////
+
+static inline uint64_t nonZeroBytes(uint64_t word)
+{
+    // the top bit of each byte of a word set if the byte is not 0
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL;
+    return (word | ((word & low7) + low7)) & ~low7;
+}
+
+/*static*/ bool GridValidator::changesGivens(const uint8_t grid[81], const uint8_t puzzle[81])
+{
+    // whether the grid has another number in any cell given in the puzzle
+    // (8 cells at a time, as the bytes of a word: any which are given in the puzzle and differ in the grid)
+    uint64_t changed = 0;
+    for (int cell = 0; cell < 80; cell += 8)
+    {
+        uint64_t gridWord, puzzleWord;
+        std::memcpy(&gridWord, grid + cell, sizeof(gridWord));
+        std::memcpy(&puzzleWord, puzzle + cell, sizeof(puzzleWord));
+        changed |= nonZeroBytes(puzzleWord) & nonZeroBytes(puzzleWord ^ gridWord);
+    }
+    return changed != 0 || (puzzle[80] != 0 && puzzle[80] != grid[80]);
+}
+
+/*static*/ void GridValidator::validate(const uint8_t grids[][81], const uint8_t puzzles[][81], size_t count, Result results[],
+                                        const BoardLayout &layout /*= BoardLayout::standard()*/)
+{
+    // check `count` grids, each against the puzzle at the same index (`puzzles` may be null to check the grids alone)
+    // a grid is solved if the bits of each unit's numbers OR together to exactly bits 1 to 9:
+    // with 9 cells that means each number once, and an empty cell (or a number out of range) becomes bit 0, which spoils it
+    struct NumBits
+    {
+        uint16_t bits[256];
+        NumBits()
+        {
+            for (int num = 0; num < 256; num++)
+                bits[num] = uint16_t((num >= 1 && num <= 9) ? 1 << num : 1);
+        }
+    };
+    static const NumBits numBits;
+
+    uint16_t cellBits[81][Lanes];       // [cell][lane] -> bit for the number in the cell
+    for (size_t first = 0; first < count; first += Lanes)
+    {
+        // (a last block of fewer than `Lanes` grids fills the spare lanes with its first grid)
+        size_t lanes = std::min(count - first, size_t(Lanes));
+        bool givensChanged[Lanes];
+        for (int lane = 0; lane < Lanes; lane++)
+        {
+            size_t index = first + ((size_t(lane) < lanes) ? size_t(lane) : 0);
+            const uint8_t *grid = grids[index];
+            for (int cell = 0; cell < 81; cell++)
+                cellBits[cell][lane] = numBits.bits[grid[cell]];
+            givensChanged[lane] = (puzzles != nullptr && changesGivens(grid, puzzles[index]));
+        }
+
+        uint16_t unsolved[Lanes] = {};
+        for (int unit = 0; unit < layout.unitCount; unit++)
+        {
+            const uint8_t *cells = layout.unitCells[unit];
+            uint16_t covered[Lanes] = {};
+            for (int index = 0; index < 9; index++)
+            {
+                const uint16_t *bits = cellBits[cells[index]];
+                for (int lane = 0; lane < Lanes; lane++)
+                    covered[lane] |= bits[lane];
+            }
+            for (int lane = 0; lane < Lanes; lane++)
+                unsolved[lane] |= covered[lane] ^ 0x3fe;
+        }
+        for (size_t lane = 0; lane < lanes; lane++)
+            results[first + lane] = (unsolved[lane] != 0) ? NotSolved : givensChanged[lane] ? GivensChanged : Valid;
+    }
+}
+
+/*static*/ GridValidator::Result GridValidator::validate(const uint8_t grid[81], const uint8_t puzzle[81],
+                                                         const BoardLayout &layout /*= BoardLayout::standard()*/)
+{
+    // (one grid goes through as a short block of its own: for many, pass them all at once)
+    Result result;
+    validate(reinterpret_cast<const uint8_t (*)[81]>(grid), reinterpret_cast<const uint8_t (*)[81]>(puzzle), 1, &result, layout);
+    return result;
+}
+
+/*static*/ const char *GridValidator::resultName(Result result)
+{
+    static const char *const resultNames[] = { "valid", "unsolved", "givens-changed" };
+    return (result <= GivensChanged) ? resultNames[result] : "";
+}
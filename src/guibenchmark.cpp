@@ -0,0 +1,152 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "guibenchmark.h"
+#include "mainwindow.h"
+
+
+////////// CLASS GuiBenchmark //////////
+
+GuiBenchmark::Stats::Stats()
+{
+    frames = 0;
+    frameNsecs = maxFrameNsecs = 0;
+    paintCalls = 0;
+    steps = flashTicks = 0;
+    stepDataChanged = flashDataChanged = 0;
+}
+
+void GuiBenchmark::Stats::add(const Stats &other)
+{
+    frames += other.frames;
+    frameNsecs += other.frameNsecs;
+    maxFrameNsecs = std::max(maxFrameNsecs, other.maxFrameNsecs);
+    paintCalls += other.paintCalls;
+    steps += other.steps;
+    flashTicks += other.flashTicks;
+    stepDataChanged += other.stepDataChanged;
+    flashDataChanged += other.flashDataChanged;
+}
+
+GuiBenchmark::GuiBenchmark()
+{
+    dataChangedCount = 0;
+}
+
+/*static*/ bool GuiBenchmark::isBenchmarkOption(const char *arg)
+{
+    return std::strcmp(arg, "--gui-benchmark") == 0;
+}
+
+void GuiBenchmark::paintFrame(BoardView &view, Stats &stats)
+{
+    // let the view paint whatever has changed, as it would on getting back to the event loop
+    int paintsBefore = view.cellDelegate->paintCount;
+    QElapsedTimer timer;
+    timer.start();
+    QCoreApplication::processEvents();
+    qint64 nsecs = timer.nsecsElapsed();
+    stats.frames++;
+    stats.frameNsecs += nsecs;
+    stats.maxFrameNsecs = std::max(stats.maxFrameNsecs, nsecs);
+    stats.paintCalls += view.cellDelegate->paintCount - paintsBefore;
+}
+
+void GuiBenchmark::flashCycle(BoardView &view, Stats &stats)
+{
+    // the ticks of the flasher's timer, which is stopped so that they come straight after each other
+    view.cellFlasher.timer.stop();
+    while (view.cellFlasher.countdown > 0)
+    {
+        int dataChangedBefore = dataChangedCount;
+        view.cellFlasherTimeout();
+        view.cellFlasher.timer.stop();
+        stats.flashTicks++;
+        stats.flashDataChanged += dataChangedCount - dataChangedBefore;
+        paintFrame(view, stats);
+    }
+}
+
+bool GuiBenchmark::solveStep(BoardModel &board, BoardView &view, Stats &stats, bool start)
+{
+    // as `MainWindow::actionSolveStart()` or `actionSolveStep()`, then the flash cycle after it
+    // return false if no step was found
+    int dataChangedBefore = dataChangedCount;
+    board.stopFlashing();
+    CellNum cellNum;
+    if (start)
+        board.solveStart();
+    else
+        cellNum = board.solveStep();
+    board.startFlashing();
+    stats.steps++;
+    stats.stepDataChanged += dataChangedCount - dataChangedBefore;
+    paintFrame(view, stats);
+    flashCycle(view, stats);
+    return start || !cellNum.isEmpty();
+}
+
+/*static*/ QString GuiBenchmark::statsText(const Stats &stats)
+{
+    // e.g. "45 steps, 406 frames, frame mean 0.42ms max 3.10ms, 12.3 paint calls/frame, 6.1 dataChanged/step, 3.2 dataChanged/tick"
+    int frames = std::max(stats.frames, 1);
+    return QString("%1 steps, %2 frames, frame mean %3ms max %4ms, %5 paint calls/frame, %6 dataChanged/step, %7 dataChanged/tick")
+            .arg(stats.steps).arg(stats.frames)
+            .arg(double(stats.frameNsecs) / frames / 1e6, 0, 'f', 2).arg(double(stats.maxFrameNsecs) / 1e6, 0, 'f', 2)
+            .arg(double(stats.paintCalls) / frames, 0, 'f', 1)
+            .arg(double(stats.stepDataChanged) / std::max(stats.steps, 1), 0, 'f', 1)
+            .arg(double(stats.flashDataChanged) / std::max(stats.flashTicks, 1), 0, 'f', 1);
+}
+
+int GuiBenchmark::run(const QString &directory)
+{
+    // (needs a `QApplication`)
+    // only the boards saved as text are puzzles: a directory may hold sessions and other files too
+    QTextStream out(stdout);
+    QFileInfoList files(QDir(directory).entryInfoList(QStringList("*.txt"), QDir::Files, QDir::Name));
+    if (files.isEmpty())
+    {
+        out << directory << ": no puzzles" << endl;
+        return 1;
+    }
+
+    BoardModel board;
+    BoardView view;
+    view.setModel(&board);
+    view.setShowPossibilities(true);
+    view.show();
+    QObject::connect(&board, &QAbstractItemModel::dataChanged, [this]() { dataChangedCount++; });
+
+    Stats total;
+    for (const QFileInfo &fileInfo : files)
+    {
+        QFile f(fileInfo.filePath());
+        if (!f.open(QIODevice::ReadOnly | QIODevice::Text))
+            continue;
+        QTextStream ts(&f);
+        try {
+            board.loadBoard(ts);
+        } catch (const std::exception &e) {
+            out << fileInfo.fileName() << ": " << e.what() << endl;
+            continue;
+        }
+        Stats stats;
+        paintFrame(view, stats);
+
+        // Solve Start, then Step until solved or no step is found
+        solveStep(board, view, stats, true);
+        while (stats.steps <= 81 && !board.isSolved() && solveStep(board, view, stats, false))
+            ;
+        out << fileInfo.fileName() << ": " << statsText(stats) << endl;
+        total.add(stats);
+    }
+    out << "total: " << statsText(total) << endl;
+    return 0;
+}
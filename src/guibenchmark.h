@@ -0,0 +1,45 @@
+#ifndef GUIBENCHMARK_H
+#define GUIBENCHMARK_H
+
+#include <QString>
+#include <QtGlobal>
+
+class BoardModel;
+class BoardView;
+
+////////// CLASS GuiBenchmark //////////
+// measures the board view's painting, for `--gui-benchmark [DIR]`, under the offscreen platform so it needs no display
+// each board text file (*.txt) in DIR (saves/ by default) is loaded with possibilities shown and solved as Solve Start and Step do,
+// each step followed by a full cycle of the cell flasher, its ticks driven one after another rather than every 500ms
+// after the load, each step and each tick the view paints what has changed as one "frame", which is timed
+// it reports the frames' times, the delegate's paint calls per frame and the model's dataChanged signals per step and tick
+class GuiBenchmark
+{
+public:
+    GuiBenchmark();
+
+    static bool isBenchmarkOption(const char *arg);
+    int run(const QString &directory);
+
+private:
+    struct Stats
+    {
+        int frames;
+        qint64 frameNsecs, maxFrameNsecs;
+        long long paintCalls;
+        int steps, flashTicks;
+        long long stepDataChanged, flashDataChanged;
+
+        Stats();
+        void add(const Stats &other);
+    };
+
+    int dataChangedCount;
+
+    void paintFrame(BoardView &view, Stats &stats);
+    void flashCycle(BoardView &view, Stats &stats);
+    bool solveStep(BoardModel &board, BoardView &view, Stats &stats, bool start);
+    static QString statsText(const Stats &stats);
+};
+
+#endif // GUIBENCHMARK_H
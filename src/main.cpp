@@ -1,9 +1,25 @@
+#include "batchsolver.h"
+#include "guibenchmark.h"
 #include "mainwindow.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && BatchSolver::isBatchOption(argv[1]))
+    {
+        BatchSolver batchSolver;
+        return batchSolver.run(argc, argv);
+    }
+    if (argc > 1 && GuiBenchmark::isBenchmarkOption(argv[1]))
+    {
+        // (painting offscreen unless told otherwise, so that it can run without a display)
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        QApplication a(argc, argv);
+        GuiBenchmark guiBenchmark;
+        return guiBenchmark.run((argc > 2) ? argv[2] : "saves");
+    }
     QApplication a(argc, argv);
     MainWindow mw;
     mw.show();
@@ -1,15 +1,22 @@
 #include <QComboBox>
 #include <QCoreApplication>
+#include <QDockWidget>
 #include <QFileDialog>
 #include <QHeaderView>
 #include <QMenuBar>
 #include <QMetaProperty>
 #include <QMessageBox>
 #include <QPainter>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QStatusBar>
 
+#include <cstring>
 #include <stdexcept>
 
+#include "collectionbrowser.h"
 #include "mainwindow.h"
+#include "puzzletext.h"
 
 
 ////////// CLASS MainWindow //////////
@@ -28,7 +35,9 @@ MainWindow::MainWindow(QWidget *parent)
     QMenu *fileMenu = menuBar()->addMenu("&File");
     fileMenu->addAction("&Clear", this, &MainWindow::actionClear);
     fileMenu->addAction("&Load", this, &MainWindow::actionLoad);
+    fileMenu->addAction("Open C&ollection", this, &MainWindow::actionOpenCollection);
     fileMenu->addAction("&Save", this, &MainWindow::actionSave);
+    fileMenu->addAction("Save Sess&ion", this, &MainWindow::actionSaveSession);
     fileMenu->addAction("E&xit", this, &MainWindow::actionExit);
 
     QMenu *solveMenu = menuBar()->addMenu("&Solve");
@@ -36,6 +45,7 @@ MainWindow::MainWindow(QWidget *parent)
     showPossibilitiesAction->setCheckable(true);
     solveMenu->addAction("St&art", this, &MainWindow::actionSolveStart);
     solveMenu->addAction("St&ep", this, &MainWindow::actionSolveStep, QKeySequence(Qt::CTRL + Qt::Key_E));
+    solveMenu->addAction("Step All &Singles", this, &MainWindow::actionSolveWave, QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_E));
     solveMenu->addSeparator();
 //    QAction *undoAction = solveMenu->addAction("Undo", this, &MainWindow::actionUndo, QKeySequence::Undo);
     QAction *undoAction = board->undoStack.createUndoAction(this);
@@ -49,6 +59,30 @@ MainWindow::MainWindow(QWidget *parent)
 //    redoAction->setEnabled(false);
 
     this->setCentralWidget(boardView);
+
+    // the collection panel stays hidden until a collection is opened
+    collectionBrowser = new CollectionBrowser(this);
+    connect(collectionBrowser, &CollectionBrowser::puzzleActivated, this, &MainWindow::collectionPuzzleActivated);
+    collectionDock = new QDockWidget("Collection", this);
+    collectionDock->setWidget(collectionBrowser);
+    addDockWidget(Qt::RightDockWidgetArea, collectionDock);
+    collectionDock->hide();
+
+    // the session is saved after every step and edit, so that it can be picked up again by loading autosave.session
+    // from the user's data directory for the application (see `autosaveSession()`)
+    loadingFile = false;
+    autosaveFailed = false;
+    connect(&board->undoStack, &QUndoStack::indexChanged, this, &MainWindow::autosaveSession);
+
+    // the solution cache goes in the user's data directory for the application, not among the saved boards
+    // it is optional, so carry on without it if it cannot be opened (e.g. another instance has it), but say so
+    QDir().mkpath(dataDirectory());
+    try {
+        solutionCache.open((dataDirectory() + "/solutions.cache").toStdString(), size_t(16) << 20);
+        board->setSolutionCache(&solutionCache);
+    } catch (const std::exception &e) {
+        statusBar()->showMessage(QString("Solution cache not available: %1").arg(e.what()), 10000);
+    }
 }
 
 MainWindow::~MainWindow()
@@ -60,24 +94,79 @@ QString MainWindow::saveDirectory() const
     return QCoreApplication::applicationDirPath() + "/../sudokusolver/saves";
 }
 
+QString MainWindow::dataDirectory() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+}
+
 void MainWindow::loadFile(const QString &filePath)
 {
     if (filePath.isEmpty())
         return;
     QFile f(filePath);
-    if (!f.open(QIODevice::ReadOnly | QIODevice::Text))
+    if (!f.open(QIODevice::ReadOnly))
     {
         QMessageBox::warning(this, "Failed to Open File", QString("%1: %2").arg(filePath).arg(f.errorString()));
         return;
     }
-    QTextStream ts(&f);
 
+    // a session snapshot is told from a board saved as text by its first bytes
+    loadingFile = true;
     try {
-        board->loadBoard(ts);
+        if (BoardModel::isSessionData(f.peek(8)))
+        {
+            QDataStream ds(&f);
+            board->loadSession(ds);
+        }
+        else
+        {
+            f.setTextModeEnabled(true);
+            QTextStream ts(&f);
+            board->loadBoard(ts);
+        }
     } catch (const std::exception &e) {
+        loadingFile = false;
         QMessageBox::warning(this, "Error reading file", e.what());
         return;
     }
+    loadingFile = false;
+    autosaveSession();
+}
+
+bool MainWindow::saveSessionFile(const QString &filePath, QString *errorString /*= nullptr*/)
+{
+    // (written to a temporary file which then replaces the old one, so an interrupted save never loses a session)
+    QSaveFile f(filePath);
+    if (f.open(QIODevice::WriteOnly))
+    {
+        QDataStream ds(&f);
+        board->saveSession(ds);
+        if (f.commit())
+            return true;
+    }
+    if (errorString != nullptr)
+        *errorString = f.errorString();
+    return false;
+}
+
+void MainWindow::autosaveSession()
+{
+    // (in the data directory rather than among the saved boards, which are kept with the program)
+    // a failure is shown once, until an autosave works again, rather than after every step
+    if (loadingFile)
+        return;
+    QString filePath(dataDirectory() + "/autosave.session"), errorString;
+    if (saveSessionFile(filePath, &errorString))
+    {
+        if (autosaveFailed)
+            statusBar()->clearMessage();
+        autosaveFailed = false;
+    }
+    else if (!autosaveFailed)
+    {
+        statusBar()->showMessage(QString("Failed to autosave session to %1: %2").arg(filePath).arg(errorString));
+        autosaveFailed = true;
+    }
 }
 
 /*slot*/ void MainWindow::initialLoad(const QString &fileName)
@@ -100,6 +189,37 @@ void MainWindow::loadFile(const QString &filePath)
         loadFile(filePath);
 }
 
+/*slot*/ void MainWindow::actionOpenCollection()
+{
+    // a binary corpus, as made by `--to-corpus`
+    QString filePath = QFileDialog::getOpenFileName(this, "Open Collection", saveDirectory());
+    if (filePath.isEmpty())
+        return;
+    try {
+        collectionBrowser->openCollection(filePath);
+    } catch (const std::exception &e) {
+        QMessageBox::warning(this, "Failed to Open Collection", e.what());
+        return;
+    }
+    collectionDock->setWindowTitle(QFileInfo(filePath).fileName());
+    collectionDock->show();
+}
+
+/*slot*/ void MainWindow::collectionPuzzleActivated(const BoardState &puzzle)
+{
+    // as `loadFile()`, for a puzzle picked in the collection panel
+    loadingFile = true;
+    try {
+        board->loadPuzzle(puzzle);
+    } catch (const std::exception &e) {
+        loadingFile = false;
+        QMessageBox::warning(this, "Error opening puzzle", e.what());
+        return;
+    }
+    loadingFile = false;
+    autosaveSession();
+}
+
 /*slot*/ void MainWindow::actionSave()
 {
     QString filePath = QFileDialog::getSaveFileName(this, "Save File", saveDirectory());
@@ -115,6 +235,16 @@ void MainWindow::loadFile(const QString &filePath)
     board->saveBoard(ts);
 }
 
+/*slot*/ void MainWindow::actionSaveSession()
+{
+    QString filePath = QFileDialog::getSaveFileName(this, "Save Session", saveDirectory(), "Sessions (*.session)");
+    if (filePath.isNull())
+        return;
+    QString errorString;
+    if (!saveSessionFile(filePath, &errorString))
+        QMessageBox::warning(this, "Failed to Save File", QString("%1: %2").arg(filePath).arg(errorString));
+}
+
 /*slot*/ void MainWindow::actionExit()
 {
     qApp->quit();
@@ -132,6 +262,7 @@ void MainWindow::loadFile(const QString &filePath)
     board->stopFlashing();
     board->solveStart();
     board->startFlashing();
+    autosaveSession();
 }
 
 /*slot*/ void MainWindow::actionSolveStep()
@@ -141,106 +272,58 @@ void MainWindow::loadFile(const QString &filePath)
     board->stopFlashing();
     CellNum cellNum = board->solveStep();
     board->startFlashing();
+    autosaveSession();
     if (cellNum.isEmpty())
     {
-        QString message("No move could be found");
-        if (board->checkForDuplicates())
-            message += " (board is illegal/has duplicates)";
-        else if (board->isSolved())
-            message += " (board is solved)";
-        else if (board->checkForNoPossibilities())
-            message += " (board has cell with no possibilities)";
-        else
-            message += " (cannot find any move which is certain)";
-        QMessageBox::warning(this, "No Move", message);
+        QMessageBox::warning(this, "No Move", "No move could be found" + noMoveReason("cannot find any move which is certain"));
         return;
     }
 }
 
-////////// CLASS BoardModel //////////
-
-BoardModel::BoardModel(QObject *parent /*= nullptr*/)
-    : QStandardItemModel(9, 9, parent)
-{
-    _flashCellIndex = QModelIndex();
-    _flashPossibilities.clear();
-    clearAllData();
-    undoStack.push(new QUndoCommand);
-}
-
-///// STRUCT CellGroupIterator /////
-
-/*static*/ int BoardModel::CellGroupIterator::paramForDirection(BoardModel::CellGroupIteratorDirection direction, int row, int col)
-{
-    switch (direction)
-    {
-    case Row: return row;
-    case Column: return col;
-    case Square: return (row / 3) * 3 + (col / 3);
-    }
-    return -1;
-}
-
-/*static*/ void BoardModel::CellGroupIterator::rowColForIndexInSquare(int index, int square, int &row, int &col)
+/*slot*/ void MainWindow::actionSolveWave()
 {
-    row = square / 3 * 3 + index / 3;
-    col = square % 3 * 3 + index % 3;
+    showPossibilitiesAction->setChecked(true);
+    actionShowPossibilities();
+    board->stopFlashing();
+    bool consistent;
+    int count = board->solveWave(consistent);
+    board->startFlashing();
+    autosaveSession();
+    if (count == 0)
+        QMessageBox::warning(this, "No Move", "No singles could be found" + noMoveReason("Step may find a harder move"));
+    else if (!consistent)
+        QMessageBox::warning(this, "Contradiction", QString("Placing %1 singles has left the board with a contradiction").arg(count));
 }
 
-BoardModel::CellGroupIterator::CellGroupIterator(CellGroupIteratorDirection direction, int param)
+QString MainWindow::noMoveReason(const QString &otherwise) const
 {
-    this->direction = direction;
-    row0 = col0 = groupIndex = 0;
-    switch (direction)
-    {
-    case Row: row0 = param; break;
-    case Column: col0 = param; break;
-    case Square:
-        row0 = param / 3 * 3;
-        col0 = param % 3 * 3;
-        break;
-    }
-    row = row0;
-    col = col0;
+    // why no move could be found, for the message saying so
+    if (board->checkForDuplicates())
+        return " (board is illegal/has duplicates)";
+    else if (board->isSolved())
+        return " (board is solved)";
+    else if (board->checkForNoPossibilities())
+        return " (board has cell with no possibilities)";
+    return " (" + otherwise + ")";
 }
 
-BoardModel::CellGroupIterator::CellGroupIterator(CellGroupIteratorDirection direction, int row, int col)
-    : CellGroupIterator(direction, paramForDirection(direction, row, col))
-{
-}
+////////// CLASS BoardModel //////////
 
-bool BoardModel::CellGroupIterator::atEnd() const
-{
-    switch (direction)
-    {
-    case Row: return (col >= 9);
-    case Column: return (row >= 9);
-    case Square: return (row >= row0 + 3 || (row == row0 + 2 && col >= col0 + 3));
-    }
-    return true;
-}
+static const char sessionMagic[4] = { 'S', 'U', 'D', 'S' };
+static const quint16 sessionVersion = 2;     // (version 1 had no layout, so was the standard board)
 
-bool BoardModel::CellGroupIterator::next()
+BoardModel::BoardModel(QObject *parent /*= nullptr*/)
+    : QStandardItemModel(9, 9, parent)
 {
-    if (atEnd())
-        return false;
-    groupIndex++;
-    switch (direction)
-    {
-    case Row: col++; break;
-    case Column: row++; break;
-    case Square:
-        if (++col >= col0 + 3)
-        {
-            col = col0;
-            row++;
-        }
-        break;
-    }
-    return true;
+    solver.state.layout = &_layout;
+    _flashCellIndexes.clear();
+    _flashPossibilities.clear();
+    solutionCache = nullptr;
+    restoringSession = false;
+    clearAllData();
+    undoStack.push(new QUndoCommand);
 }
 
-
 ///// CLASS SetDataUndoCommand /////
 
 BoardModel::SetDataUndoCommand::SetDataUndoCommand(BoardModel *board, const QModelIndex &index, const QVariant &oldValue, const QVariant &newValue)
@@ -263,50 +346,35 @@ BoardModel::SetDataUndoCommand::SetDataUndoCommand(BoardModel *board, const QMod
 }
 
 
-void BoardModel::setPossibility(int row, int col, int num, bool possible)
+void BoardModel::possibilitiesChanged(const BoardState &before)
 {
-    if (possibilities[row][col][num] == possible)
-        return;
-    possibilities[row][col][num] = possible;
-    QModelIndex ix(index(row, col));
-    FlashPossibilities fp(ix, num);
-    _flashPossibilities.append(fp);
-    emit dataChanged(ix, ix);
-    //VERYTEMPORARY
-//    if (num == 7)
-//    {
-//        QCoreApplication::processEvents();
-//        qDebug() << num;
-//    }
+    // the solver has removed possibilities since `before`
+    // mark each of them to be flashed, and the cells they are in as changed
+    for (int row = 0; row < 9; row++)
+        for (int col = 0; col < 9; col++)
+        {
+            quint16 removed = before.cellPossibilities[row * 9 + col] & ~solver.state.cellPossibilities[row * 9 + col];
+            if (removed == 0)
+                continue;
+            QModelIndex ix(index(row, col));
+            for (; removed != 0; removed &= removed - 1)
+                _flashPossibilities.append(FlashPossibilities(ix, lowestBit64(removed)));
+            emit dataChanged(ix, ix);
+        }
 }
 
 void BoardModel::resetAllPossibilities()
 {
-    for (int row = 0; row < 9; row++)
-        for (int col = 0; col < 9; col++)
-            for (int num = 1; num <= 9; num++)
-                possibilities[row][col][num] = true;
+    solver.resetAllPossibilities();
     possibilitiesInitialised = false;
     emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
 }
 
-void BoardModel::reducePossibilities(int row, int col)
-{
-    int numHere = numInCell(row, col);
-    if (numHere == 0)
-        return;
-    for (int num = 1; num <= 9; num++)
-        setPossibility(row, col, num, false);
-    for (CellGroupIteratorDirection direction : {Column, Row, Square})
-        for (CellGroupIterator cgit(direction, row, col); !cgit.atEnd(); cgit.next())
-            setPossibility(cgit.row, cgit.col, numHere, false);
-}
-
 void BoardModel::reduceAllPossibilities()
 {
-    for (int row = 0; row < 9; row++)
-        for (int col = 0; col < 9; col++)
-            reducePossibilities(row, col);
+    BoardState before(solver.state);
+    solver.reduceAllPossibilities();
+    possibilitiesChanged(before);
     possibilitiesInitialised = true;
 }
 
@@ -316,6 +384,9 @@ void BoardModel::clearAllData()
     for (int row = 0; row < rowCount(); row++)
         for (int col = 0; col < columnCount(); col++)
             clearItemData(index(row, col));
+    solver.state.clear();
+    _layout = BoardLayout();
+    givens = Bitboard81();
     resetAllPossibilities();
     undoStack.clear();
 }
@@ -329,28 +400,12 @@ void BoardModel::clearBoard()
 
 int BoardModel::numInCell(int row, int col) const
 {
-    return index(row, col).data().toInt();
+    return solver.state.numInCell(row, col);
 }
 
 bool BoardModel::isSolved() const
 {
-    for (int row = 0; row < rowCount(); row++)
-        for (int col = 0; col < columnCount(); col++)
-            if (numInCell(row, col) == 0)
-                return false;
-    return true;
-}
-
-bool BoardModel::numInCellHasDuplicate(int row, int col) const
-{
-    int num = numInCell(row, col);
-    if (num == 0)
-        return false;
-    for (CellGroupIteratorDirection direction : {Column, Row, Square})
-        for (CellGroupIterator cgit(direction, row, col); !cgit.atEnd(); cgit.next())
-            if (!(cgit.row == row && cgit.col == col) && numInCell(cgit.row, cgit.col) == num)
-                return true;
-    return false;
+    return solver.state.isSolved();
 }
 
 bool BoardModel::checkForDuplicates()
@@ -359,7 +414,7 @@ bool BoardModel::checkForDuplicates()
     for (int row = 0; row < 9; row++)
         for (int col = 0; col < 9; col++)
         {
-            bool duplicate = numInCellHasDuplicate(row, col);
+            bool duplicate = solver.state.numInCellHasDuplicate(row, col);
             setData(index(row, col), duplicate ? QColor(Qt::red) : QVariant(), Qt::ForegroundRole);
             anyDuplicate |= duplicate;
         }
@@ -368,18 +423,7 @@ bool BoardModel::checkForDuplicates()
 
 bool BoardModel::checkForNoPossibilities() const
 {
-    for (int row = 0; row < 9; row++)
-        for (int col = 0; col < 9; col++)
-            if (numInCell(row, col) == 0)
-            {
-                int count = 0;
-                for (int num = 1; num <= 9; num++)
-                    if (possibilities[row][col][num])
-                        count++;
-                if (count == 0)
-                    return true;
-            }
-    return false;
+    return solver.state.checkForNoPossibilities();
 }
 
 void BoardModel::loadBoard(QTextStream &ts)
@@ -387,30 +431,22 @@ void BoardModel::loadBoard(QTextStream &ts)
     beginResetModel();
     clearAllData();
     try {
-        int row = 0;
-        while (!ts.atEnd())
-        {
-            if (row >= rowCount())
-                throw std::runtime_error("Too many lines in file");
-            QString line = ts.readLine();
-            QStringList nums = line.split(" ", QString::SkipEmptyParts);
-            if (nums.count() != columnCount())
-                throw std::runtime_error("Incorrect number of elements in line");
-            for (int col = 0; col < columnCount(); col++)
-            {
-                bool ok;
-                int num = nums[col].toInt(&ok);
-                if (ok)
-                    ok = (num >= 0 && num <= 9);
-                if (!ok)
-                    throw std::runtime_error("Bad number in file");
-                if (!setData(index(row, col), (num != 0) ? num : QVariant()))
-                    throw std::runtime_error("Failed to set data for element in line");
-            }
-            row++;
-        }
-        if (row != rowCount())
+        QByteArray text(ts.readAll().toLatin1());
+        // a variant's layout comes in comment lines, which the parser skips
+        for (const QByteArray &line : text.split('\n'))
+            _layout.parseTextLine(line.constData(), size_t(line.size()));
+        PuzzleTextParser parser(text.constData(), size_t(text.size()));
+        BoardState state, extra;
+        PuzzleTextParser::Result result = parser.next(state);
+        if (result == PuzzleTextParser::End)
+            result = parser.finish();
+        if (result == PuzzleTextParser::Error)
+            throw std::runtime_error(std::string(parser.errorMessage()) + " (line " + std::to_string(parser.lineNumber()) + ")");
+        if (result != PuzzleTextParser::Parsed)
             throw std::runtime_error("Too few lines in file");
+        if (parser.next(extra) != PuzzleTextParser::End)
+            throw std::runtime_error("Too many lines in file");
+        setGivens(state);
     } catch (const std::exception &e) {
         endResetModel();
         throw;
@@ -419,348 +455,260 @@ void BoardModel::loadBoard(QTextStream &ts)
     endResetModel();
 }
 
-void BoardModel::saveBoard(QTextStream &ts) const
+void BoardModel::loadPuzzle(const BoardState &puzzle)
 {
-    for (int row = 0; row < rowCount(); row++)
-    {
-        for (int col = 0; col < columnCount(); col++)
-            ts << numInCell(row, col) << " ";
-        ts << endl;
+    // a puzzle already parsed, e.g. from a collection, on the standard layout
+    beginResetModel();
+    clearAllData();
+    try {
+        setGivens(puzzle);
+    } catch (const std::exception &e) {
+        endResetModel();
+        throw;
     }
+    checkForDuplicates();
+    endResetModel();
 }
 
-void BoardModel::solveStart()
-{
-    resetAllPossibilities();
-    reduceAllPossibilities();
-}
-
-bool BoardModel::cellHasOnePossibility(int row, int col, int &num) const
+void BoardModel::setGivens(const BoardState &puzzle)
 {
-    num = 0;
-    if (numInCell(row, col) != 0)
-        return false;
-    int found = 0;
-    for (int num1 = 1; num1 <= 9; num1++)
-        if (possibilities[row][col][num1])
+    // put a puzzle's numbers into the cleared board, as its givens
+    for (int row = 0; row < rowCount(); row++)
+        for (int col = 0; col < columnCount(); col++)
         {
-            if (++found > 1)
-                return false;
-            num = num1;
+            int num = puzzle.numInCell(row, col);
+            if (!setData(index(row, col), (num != 0) ? num : QVariant()))
+                throw std::runtime_error("Failed to set data for element in line");
+            if (num != 0)
+                givens.set(row * 9 + col);
         }
-    return (found == 1);
-}
-
-CellNum BoardModel::solveFindStepPass1() const
-{
-    // find if there is a cell which has just 1 possibility available
-    int num;
-    for (int row = 0; row < 9; row++)
-        for (int col = 0; col < 9; col++)
-            if (cellHasOnePossibility(row, col, num))
-                return CellNum(row, col, num);
-    return CellNum();
-}
-
-CellNum BoardModel::cellGroupOnlyPossibilityForNum(CellGroupIteratorDirection direction, int param) const
-{
-    for (CellGroupIterator cgit(direction, param); !cgit.atEnd(); cgit.next())
-        if (numInCell(cgit.row, cgit.col) == 0)
-            for (int num = 1; num <= 9; num++)
-                if (possibilities[cgit.row][cgit.col][num])
-                {
-                    int found = 0;
-                    for (CellGroupIterator cgit2(direction, param); !cgit2.atEnd(); cgit2.next())
-                        if (numInCell(cgit2.row, cgit2.col) == 0 && possibilities[cgit2.row][cgit2.col][num])
-                            found++;
-                    if (found == 1)
-                        return CellNum(cgit.row, cgit.col, num);
-                }
-    return CellNum();
 }
 
-CellNum BoardModel::solveFindStepPass2() const
-{
-    // find if there is a "group" (row/column/square) of cells
-    // where there is some possibility which is only available *once* in the group
-    CellNum cellNum;
-    for (CellGroupIteratorDirection direction : {Column, Row, Square})
-        for (int param = 0; param < 9; param++)
-            if (!(cellNum = cellGroupOnlyPossibilityForNum(direction, param)).isEmpty())
-                return cellNum;
-    return CellNum();
-}
-
-QList<int> BoardModel::numPossibilitiesListForCell(int row, int col) const
+void BoardModel::saveBoard(QTextStream &ts) const
 {
-    // return a list of which numbers are possible in cell (row,col)
-    QList<int> nums;
-    if (numInCell(row, col) != 0)
-        return nums;
-    for (int num = 1; num <= 9; num++)
-        if (possibilities[row][col][num])
-            nums.append(num);
-    return nums;
+    ts << QString::fromStdString(_layout.toText());
+    for (int row = 0; row < rowCount(); row++)
+    {
+        for (int col = 0; col < columnCount(); col++)
+            ts << numInCell(row, col) << " ";
+        ts << endl;
+    }
 }
 
-QVector<QList<int> > BoardModel::cellGroupPossibilitiesByIndex(CellGroupIteratorDirection direction, int param) const
+/*static*/ bool BoardModel::isSessionData(const QByteArray &start)
 {
-    // return an array indexed by "group" element index
-    // where each array element is a list of which numbers are possible in the group element index
-    QVector<QList<int> > groupVec(9);
-    for (CellGroupIterator cgit(direction, param); !cgit.atEnd(); cgit.next())
-        groupVec[cgit.groupIndex] = numPossibilitiesListForCell(cgit.row, cgit.col);
-    return groupVec;
+    // whether data (from its first few bytes) is a session snapshot rather than a board as text
+    return start.startsWith(QByteArray(sessionMagic, sizeof(sessionMagic)));
 }
 
-bool BoardModel::reduceCellGroupPossibilitiesForIdenticalPairs(CellGroupIteratorDirection direction, int param)
+void BoardModel::saveSession(QDataStream &ds) const
 {
-    // if within a "group" we find 2 cells
-    // where each cell has just 2 possibilities *and* those numbers are the same in both cells
-    // we can go through all *other* cells in the group removing those 2 numbers from their possibles
-    QVector<QList<int> > groupPossibilities(cellGroupPossibilitiesByIndex(direction, param));
-    Q_ASSERT(groupPossibilities.count() == 9);
+    // a snapshot of the whole session, so that it can be carried on just as it was left
+    // the layout, the numbers, every cell's possibilities as the solver has reduced them, which cells are givens, and the undo history
+    // nothing needs working out again on loading, and it is well under 1KB, so it can be saved after every step
+    ds.setVersion(QDataStream::Qt_5_0);
+    ds.writeRawData(sessionMagic, sizeof(sessionMagic));
+    ds << sessionVersion;
+    ds << quint32(_layout.extras);
+    ds.writeRawData(reinterpret_cast<const char *>(_layout.boxes), sizeof(_layout.boxes));
+    ds.writeRawData(reinterpret_cast<const char *>(solver.state.nums), sizeof(solver.state.nums));
+    for (int cell = 0; cell < 81; cell++)
+        ds << quint16(solver.state.cellPossibilities[cell]);
+    ds << quint64(givens.lo) << quint64(givens.hi) << possibilitiesInitialised;
 
-    bool changed = false;
-    for (int cell1 = 0; cell1 < 9; cell1++)
+    // each edit on the undo stack as its cell and the numbers before and after, and how many of them are done (not undone)
+    QVector<const SetDataUndoCommand *> commands;
+    int doneCount = 0;
+    for (int i = 0; i < undoStack.count(); i++)
     {
-        if (groupPossibilities[cell1].count() != 2)
+        const SetDataUndoCommand *command = dynamic_cast<const SetDataUndoCommand *>(undoStack.command(i));
+        if (command == nullptr)
             continue;
-        for (int cell2 = cell1 + 1; cell2 < 9; cell2++)
-        {
-            if (groupPossibilities[cell2].count() != 2)
-                continue;
-            int num1 = groupPossibilities[cell1][0], num2 = groupPossibilities[cell1][1];
-            Q_ASSERT(num1 != num2);
-            if (num1 != groupPossibilities[cell2][0] || num2 != groupPossibilities[cell2][1])
-                continue;
-            for (CellGroupIterator cgit(direction, param); !cgit.atEnd(); cgit.next())
-                if (cgit.groupIndex != cell1 && cgit.groupIndex != cell2)
-                    if (possibilities[cgit.row][cgit.col][num1] || possibilities[cgit.row][cgit.col][num2])
-                    {
-                        changed = true;
-                        setPossibility(cgit.row, cgit.col, num1, false);
-                        setPossibility(cgit.row, cgit.col, num2, false);
-                    }
-        }
+        commands.append(command);
+        if (i < undoStack.index())
+            doneCount++;
     }
-    return changed;
+    ds << quint32(commands.size()) << quint32(doneCount);
+    for (const SetDataUndoCommand *command : commands)
+        ds << quint8(command->cellIndex().row() * 9 + command->cellIndex().column()) << quint8(command->oldNum()) << quint8(command->newNum());
 }
 
-bool BoardModel::reduceAllGroupPossibilitiesForIdenticalPairs()
+void BoardModel::loadSession(QDataStream &ds)
 {
-    // find if there are any "groups" (row/column/square) of cells
-    // where there are 2 cells which both have just 2 possibilities and those are the same possibilities
-    // from that we can reduce the possibilities in other members of the group to eliminate those 2 possibilities
-    bool changed = false;
-    for (CellGroupIteratorDirection direction : {Column, Row, Square})
-        for (int param = 0; param < 9; param++)
-            if (reduceCellGroupPossibilitiesForIdenticalPairs(direction, param))
-                changed = true;
-    return changed;
+    // throw on bad data, leaving the board as it was
+    struct Edit
+    {
+        quint8 cell, oldNum, newNum;
+    };
+    ds.setVersion(QDataStream::Qt_5_0);
+    char magic[sizeof(sessionMagic)];
+    if (ds.readRawData(magic, sizeof(magic)) != int(sizeof(magic)) || std::memcmp(magic, sessionMagic, sizeof(magic)) != 0)
+        throw std::runtime_error("Not a session file");
+    quint16 version = 0;
+    ds >> version;
+    if (version < 1 || version > sessionVersion)
+        throw std::runtime_error("Unsupported session file version");
+    BoardLayout layout;
+    if (version >= 2)
+    {
+        quint32 extras;
+        uint8_t boxes[81];
+        ds >> extras;
+        ds.readRawData(reinterpret_cast<char *>(boxes), sizeof(boxes));
+        if (ds.status() != QDataStream::Ok)
+            throw std::runtime_error("Bad session file");
+        layout.setBoxes(boxes);
+        layout.setExtras(extras);
+    }
+    BoardState state;
+    uint16_t possibilities[81];
+    quint64 givensLo, givensHi;
+    bool initialised;
+    quint32 commandCount, doneCount;
+    ds.readRawData(reinterpret_cast<char *>(state.nums), sizeof(state.nums));
+    for (int cell = 0; cell < 81; cell++)
+    {
+        quint16 mask;
+        ds >> mask;
+        possibilities[cell] = mask;
+    }
+    ds >> givensLo >> givensHi >> initialised >> commandCount >> doneCount;
+    if (ds.status() != QDataStream::Ok || doneCount > commandCount || commandCount > 81 * 81 * 10)
+        throw std::runtime_error("Bad session file");
+    QVector<Edit> edits(static_cast<int>(commandCount));
+    for (Edit &edit : edits)
+        ds >> edit.cell >> edit.oldNum >> edit.newNum;
+    bool valid = (ds.status() == QDataStream::Ok);
+    for (int cell = 0; cell < 81; cell++)
+        valid &= (state.nums[cell] <= 9);
+    for (const Edit &edit : edits)
+        valid &= (edit.cell < 81 && edit.oldNum <= 9 && edit.newNum <= 9);
+    if (!valid)
+        throw std::runtime_error("Bad session file");
+
+    beginResetModel();
+    clearAllData();
+    _layout = layout;
+    // the edits go back on the undo stack without being done again, as the numbers they left are restored below
+    restoringSession = true;
+    for (const Edit &edit : edits)
+        undoStack.push(new SetDataUndoCommand(this, index(edit.cell / 9, edit.cell % 9),
+                                              (edit.oldNum != 0) ? QVariant(int(edit.oldNum)) : QVariant(),
+                                              (edit.newNum != 0) ? QVariant(int(edit.newNum)) : QVariant()));
+    undoStack.setIndex(int(doneCount));
+    restoringSession = false;
+    for (int row = 0; row < rowCount(); row++)
+        for (int col = 0; col < columnCount(); col++)
+        {
+            int num = state.numInCell(row, col);
+            setData(index(row, col), (num != 0) ? num : QVariant());
+        }
+    solver.state.setAllPossibilities(possibilities);
+    givens = Bitboard81(givensLo, givensHi) & Bitboard81::all();
+    possibilitiesInitialised = initialised;
+    checkForDuplicates();
+    endResetModel();
 }
 
-QList<int> BoardModel::groupIndexPossibilitiesListForNumber(CellGroupIteratorDirection direction, int param, int num) const
+void BoardModel::solveStart()
 {
-    // return a list of which cell indexes within a group are possible for a number
-    QList<int> indexes;
-    for (CellGroupIterator cgit(direction, param); !cgit.atEnd(); cgit.next())
-        if (numInCell(cgit.row, cgit.col) == 0)
-            if (possibilities[cgit.row][cgit.col][num])
-                indexes.append(cgit.groupIndex);
-    return indexes;
+    resetAllPossibilities();
+    reduceAllPossibilities();
 }
 
-QVector<QList<int> > BoardModel::cellGroupPossibilitiesByNumber(CellGroupIteratorDirection direction, int param) const
+CellNum BoardModel::solveStep()
 {
-    // return an array indexed by possibility number
-    // where each array element is a list of which "group" element indexes are possible for the number
-    QVector<QList<int> > groupVec(10);
-    for (int num = 1; num <= 9; num++)
-        groupVec[num] = groupIndexPossibilitiesListForNumber(direction, param, num);
-    return groupVec;
+    if (!possibilitiesInitialised)
+        solveStart();
+    BoardState before(solver.state);
+    CellNum cellNum = solver.solveFindStep();
+    possibilitiesChanged(before);
+    if (cellNum.isEmpty())
+        cellNum = solutionCacheStep();
+    if (cellNum.isEmpty())
+        return cellNum;
+    QModelIndex cellIndex(index(cellNum.row, cellNum.col));
+    setData(cellIndex, cellNum.num);
+    _flashCellIndexes.append(cellIndex);
+    reduceAllPossibilities();
+    return cellNum;
 }
 
-bool BoardModel::reduceCellGroupPossibilitiesForUniquePairs(CellGroupIteratorDirection direction, int param)
+int BoardModel::solveWave(bool &consistent)
 {
-    // if within a "group" we find 2 cells
-    // which have among their (any number of) possibilities some 2 common possible numbers
-    // where neither of those 2 numbers is in any *other* cells' possibilities
-    // we can reduce the possibilities in those 2 cells to eliminate any *other* possibilities
-    // *and* then we can reduce the possibilities in any *other* cells to remove the 2 numbers
-    QVector<QList<int> > groupPossibilities(cellGroupPossibilitiesByNumber(direction, param));
-    Q_ASSERT(groupPossibilities.count() == 10);
-
-    bool changed = false;
-    for (int num1 = 1; num1 <= 9; num1++)
+    // place every naked and hidden single there is at once, as one step ("wave")
+    // return how many were placed, with `consistent` false if they have left the board with a contradiction
+    if (!possibilitiesInitialised)
+        solveStart();
+    CellNum wave[81];
+    int count = solver.solveFindWave(wave);
+    consistent = true;
+    if (count == 0)
+        return 0;
+    BoardState before(solver.state);
+    for (int i = 0; i < count; i++)
     {
-        if (groupPossibilities[num1].count() != 2)
-            continue;
-        for (int num2 = num1 + 1; num2 <= 9; num2++)
-        {
-            if (groupPossibilities[num2].count() != 2)
-                continue;
-            int cell1 = groupPossibilities[num1][0], cell2 = groupPossibilities[num1][1];
-            Q_ASSERT(cell1 != cell2);
-            if (cell1 != groupPossibilities[num2][0] || cell2 != groupPossibilities[num2][1])
-                continue;
-            for (CellGroupIterator cgit(direction, param); !cgit.atEnd(); cgit.next())
-                if (cgit.groupIndex == cell1 || cgit.groupIndex == cell2)
-                {
-                    for (int num = 1; num <= 9; num++)
-                        if (num != num1 && num != num2)
-                            if (possibilities[cgit.row][cgit.col][num])
-                            {
-                                changed = true;
-                                setPossibility(cgit.row, cgit.col, num, false);
-                            }
-                }
-                else
-                {
-                    if (possibilities[cgit.row][cgit.col][num1] || possibilities[cgit.row][cgit.col][num2])
-                    {
-                        changed = true;
-                        setPossibility(cgit.row, cgit.col, num1, false);
-                        setPossibility(cgit.row, cgit.col, num2, false);
-                    }
-                }
-        }
+        QModelIndex cellIndex(index(wave[i].row, wave[i].col));
+        setData(cellIndex, wave[i].num);
+        _flashCellIndexes.append(cellIndex);
     }
-    return changed;
-}
-
-bool BoardModel::reduceAllGroupPossibilitiesForUniquePairs()
-{
-    // find if there are any "groups" (row/column/square) of cells
-    // where there are just 2 cells which both have among their (any number of) possibilities
-    // some 2 numbers neither of which is in any *other* cells' possibilities
-    // from that we can reduce the possibilities in those 2 cells to eliminate any *other* possibilities
-    // *and* then we will be able to reduce the possibilities in other members of the group to eliminate those 2 possibilities
-    // per `reduceAllGroupPossibilitiesForIdenticalPairs()`
-    bool changed = false;
-    for (CellGroupIteratorDirection direction : {Column, Row, Square})
-        for (int param = 0; param < 9; param++)
-            if (reduceCellGroupPossibilitiesForUniquePairs(direction, param))
-                changed = true;
-    return changed;
+    consistent = solver.applyWave(wave, count);
+    possibilitiesChanged(before);
+    return count;
+}
+
+CellNum BoardModel::solutionCacheStep()
+{
+    // when logic finds no move, take one from the board's solution
+    // which the solution cache has (or now gets) if the board has just one solution
+    // (the cache's solutions are of standard boards only)
+    if (solutionCache == nullptr || !solutionCache->isOpen() || !_layout.isStandard())
+        return CellNum();
+    BoardState solution;
+    if (solutionCache->solve(solver.state, solution) != 1)
+        return CellNum();
+    for (int cell = 0; cell < 81; cell++)
+        if (solver.state.nums[cell] == 0)
+            return CellNum(cell / 9, cell % 9, solution.nums[cell]);
+    return CellNum();
 }
 
-bool BoardModel::reduceRowColumnPossibilitiesForSquare(int param)
+bool BoardModel::numIsPossible(int num, const QModelIndex &index) const
 {
-    // find if in a square
-    // there is a number *all* of whose possibilities lie *only* in a row or a column in the square
-    // from that we can reduce the possibilities in any *other* squares the row or column runs through
-    QVector<QList<int> > groupPossibilities(cellGroupPossibilitiesByNumber(Square, param));
-    Q_ASSERT(groupPossibilities.count() == 10);
-
-    bool changed = false;
-    for (int num = 1; num <= 9; num++)
-    {
-        int count = groupPossibilities[num].count();
-        if (count < 2 || count > 3)
-            continue;
-        int row0, col0, row1, col1, row2, col2;
-        CellGroupIterator::rowColForIndexInSquare(groupPossibilities[num][0], param, row0, col0);
-        CellGroupIterator::rowColForIndexInSquare(groupPossibilities[num][1], param, row1, col1);
-        row2 = row1; col2 = col1;
-        if (count == 3)
-            CellGroupIterator::rowColForIndexInSquare(groupPossibilities[num][2], param, row2, col2);
-        CellGroupIteratorDirection direction;
-        if (row1 == row0 && row2 == row0)
-            direction = Row;
-        else if (col1 == col0 && col2 == col0)
-            direction = Column;
-        else
-            continue;
-        for (CellGroupIterator cgit(direction, (direction == Row) ? row0 : col0); !cgit.atEnd(); cgit.next())
-            if (CellGroupIterator::paramForDirection(Square, cgit.row, cgit.col) != param)
-                if (numInCell(cgit.row, cgit.col) == 0)
-                    if (possibilities[cgit.row][cgit.col][num])
-                    {
-                        changed = true;
-                        setPossibility(cgit.row, cgit.col, num, false);
-                    }
-    }
-    return changed;
+    Q_ASSERT(num >= 1 && num <= 9);
+    Q_ASSERT(index.isValid());
+    return solver.state.cellHasPossibility(index.row(), index.column(), num);
 }
 
-bool BoardModel::reduceAllRowColumnPossibilitiesForSquares()
+int BoardModel::chainTimeBudget() const
 {
-    // find if there are any squares of cells
-    // where there is a number *all* of whose possibilities lie *only* in a row or a column in the square
-    // from that we can reduce the possibilities in any *other* squares the row or column runs through
-    bool changed = false;
-    for (int param = 0; param < 9; param++)
-        if (reduceRowColumnPossibilitiesForSquare(param))
-            changed = true;
-    return changed;
+    return solver.chainTimeBudget();
 }
 
-CellNum BoardModel::solveFindStepPass3()
+void BoardModel::setChainTimeBudget(int msecs)
 {
-    bool changed;
-    do
-    {
-        changed = false;
-        if (!changed)
-            changed = reduceAllGroupPossibilitiesForIdenticalPairs();
-        if (!changed)
-            changed = reduceAllGroupPossibilitiesForUniquePairs();
-        if (!changed)
-            changed = reduceAllRowColumnPossibilitiesForSquares();
-        if (changed)
-        {
-            CellNum cellnum = solveFindStepPass1();
-            if (!cellnum.isEmpty())
-                return cellnum;
-            cellnum = solveFindStepPass2();
-            if (!cellnum.isEmpty())
-                return cellnum;
-        }
-    } while (changed);
-    return CellNum();
+    solver.setChainTimeBudget(msecs);
 }
 
-CellNum BoardModel::solveFindStep()
+int BoardModel::probeBudget() const
 {
-    CellNum cellNum;
-    cellNum = solveFindStepPass1();
-    if (!cellNum.isEmpty())
-        return cellNum;
-    cellNum = solveFindStepPass2();
-    if (!cellNum.isEmpty())
-        return cellNum;
-    cellNum = solveFindStepPass3();
-    if (!cellNum.isEmpty())
-        return cellNum;
-    return CellNum();
+    return solver.probeBudget();
 }
 
-CellNum BoardModel::solveStep()
+void BoardModel::setProbeBudget(int probes)
 {
-    if (!possibilitiesInitialised)
-        solveStart();
-    CellNum cellNum = solveFindStep();
-    if (cellNum.isEmpty())
-        return cellNum;
-    QModelIndex cellIndex(index(cellNum.row, cellNum.col));
-    setData(cellIndex, cellNum.num);
-    _flashCellIndex = cellIndex;
-    reduceAllPossibilities();
-    return cellNum;
+    solver.setProbeBudget(probes);
 }
 
-bool BoardModel::numIsPossible(int num, const QModelIndex &index) const
+void BoardModel::setSolutionCache(SolutionCache *cache)
 {
-    Q_ASSERT(num >= 1 && num <= 9);
-    Q_ASSERT(index.isValid());
-    return possibilities[index.row()][index.column()][num];
+    solutionCache = cache;
 }
 
 void BoardModel::stopFlashing()
 {
     emit endFlashing();
-    _flashCellIndex = QModelIndex();
+    _flashCellIndexes.clear();
     _flashPossibilities.clear();
 }
 
@@ -779,6 +727,8 @@ void BoardModel::markFlashPossibilitiesAsChanged()
 void BoardModel::doSetDataUndoCommand(const QModelIndex &index, const QVariant &oldValue, const QVariant &newValue)
 {
     Q_UNUSED(oldValue);
+    if (restoringSession)
+        return;
     if (!setData(index, newValue, Qt::EditRole))
         return;
     stopFlashing();
@@ -807,6 +757,7 @@ void BoardModel::doSetDataUndoCommand(const QModelIndex &index, const QVariant &
     case Qt::FontRole: {
         QFont font;
         font.setPointSize(18);
+        font.setBold(givens.test(index.row() * 9 + index.column()));
         return font;
     }
     case Qt::TextAlignmentRole:
@@ -838,7 +789,10 @@ void BoardModel::doSetDataUndoCommand(const QModelIndex &index, const QVariant &
                 return false;
             value2 = (num != 0) ? QVariant(num) : QVariant();
         }
-        return QStandardItemModel::setData(index, value2, role);
+        if (!QStandardItemModel::setData(index, value2, role))
+            return false;
+        solver.state.setNumInCell(index.row(), index.column(), value2.toInt());
+        return true;
     }
     default: break;
     }
@@ -914,8 +868,8 @@ bool BoardView::flashHide() const
 {
     if (cellFlasher.countdown > 0)
         cellFlasher.countdown--;
-    const QModelIndex &index(boardModel->flashCellIndex());
-    if (index.isValid())
+    const QList<QModelIndex> &indexes(boardModel->flashCellIndexes());
+    for (const QModelIndex &index : indexes)
         boardModel->setData(index, flashHide() ? QColor(0, 0, 0, 0) : QVariant(), Qt::ForegroundRole);
     if (cellDelegate->showPossibilities())
         boardModel->markFlashPossibilitiesAsChanged();
@@ -933,6 +887,7 @@ BoardCellDelegate::BoardCellDelegate(BoardView *boardViewParent)
     boardView = boardViewParent;
     boardModel = nullptr;
     _showPossibilities = false;
+    paintCount = 0;
 }
 
 bool BoardCellDelegate::showPossibilities() const
@@ -974,18 +929,24 @@ bool BoardCellDelegate::isNumToBeFlashed(int num, const QModelIndex &index, cons
 
 /*virtual*/ void BoardCellDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const /*override*/
 {
+    // a cell in any of a variant's extra units is shaded, and a thick line goes between cells in different boxes
+    paintCount++;
+    const BoardLayout &layout(boardModel->layout());
+    int cell = index.row() * 9 + index.column();
     painter->save();
+    if (layout.cellUnitCounts[cell] > 3)
+        painter->fillRect(option.rect, QColor(230, 230, 250));
     QPen pen;
     pen.setWidth(2);
     pen.setColor(Qt::black);
     painter->setPen(pen);
-    if (index.column() % 3 == 0)
+    if (index.column() == 0 || layout.boxes[cell - 1] != layout.boxes[cell])
         painter->drawLine(option.rect.topLeft(), option.rect.bottomLeft());
-    else if (index.column() % 3 == 2)
+    if (index.column() == 8 || layout.boxes[cell + 1] != layout.boxes[cell])
         painter->drawLine(option.rect.topRight(), option.rect.bottomRight());
-    if (index.row() % 3 == 0)
+    if (index.row() == 0 || layout.boxes[cell - 9] != layout.boxes[cell])
         painter->drawLine(option.rect.topLeft(), option.rect.topRight());
-    else if (index.row() % 3 == 2)
+    if (index.row() == 8 || layout.boxes[cell + 9] != layout.boxes[cell])
         painter->drawLine(option.rect.bottomLeft(), option.rect.bottomRight());
     painter->restore();
 
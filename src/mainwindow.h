@@ -1,6 +1,7 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QDataStream>
 #include <QDebug>
 #include <QList>
 #include <QMainWindow>
@@ -12,24 +13,14 @@
 #include <QUndoStack>
 #include <QVector>
 
+#include "boardsolver.h"
+#include "solutioncache.h"
+
 class BoardModel;
 class BoardView;
 class BoardCellDelegate;
-
-struct CellNum
-{
-    int row, col;
-    int num;
-
-    CellNum() { row = col = num = 0; }
-    CellNum(int row, int col, int num)
-    {
-        this->row = row;
-        this->col = col;
-        this->num = num;
-    }
-    bool isEmpty() const { return (num == 0); };
-};
+class CollectionBrowser;
+class QDockWidget;
 
 ////////// CLASS MainWindow //////////
 class MainWindow : public QMainWindow
@@ -45,8 +36,17 @@ public:
 
 private:
     QAction *showPossibilitiesAction;
+    CollectionBrowser *collectionBrowser;
+    QDockWidget *collectionDock;
+    SolutionCache solutionCache;
+    bool loadingFile;
+    bool autosaveFailed;
     QString saveDirectory() const;
+    QString dataDirectory() const;
     void loadFile(const QString &filePath);
+    bool saveSessionFile(const QString &filePath, QString *errorString = nullptr);
+    void autosaveSession();
+    QString noMoveReason(const QString &otherwise) const;
 
 public slots:
     void initialLoad(const QString &fileName);
@@ -54,11 +54,15 @@ public slots:
 private slots:
     void actionClear();
     void actionLoad();
+    void actionOpenCollection();
     void actionSave();
+    void actionSaveSession();
     void actionExit();
     void actionShowPossibilities();
     void actionSolveStart();
     void actionSolveStep();
+    void actionSolveWave();
+    void collectionPuzzleActivated(const BoardState &puzzle);
 };
 
 
@@ -87,12 +91,23 @@ public:
     bool checkForDuplicates();
     bool checkForNoPossibilities() const;
     void loadBoard(QTextStream &ts);
+    void loadPuzzle(const BoardState &puzzle);
     void saveBoard(QTextStream &ts) const;
+    static bool isSessionData(const QByteArray &start);
+    void loadSession(QDataStream &ds);
+    void saveSession(QDataStream &ds) const;
     void solveStart();
     CellNum solveStep();
+    int solveWave(bool &consistent);
     bool numIsPossible(int num, const QModelIndex &index) const;
-
-    const QModelIndex &flashCellIndex() { return _flashCellIndex; }
+    int chainTimeBudget() const;
+    void setChainTimeBudget(int msecs);
+    int probeBudget() const;
+    void setProbeBudget(int probes);
+    void setSolutionCache(SolutionCache *cache);
+    const BoardLayout &layout() const { return _layout; }
+
+    const QList<QModelIndex> &flashCellIndexes() { return _flashCellIndexes; }
     const QList<FlashPossibilities> &flashPossibilities() { return _flashPossibilities; };
     void stopFlashing();
     void startFlashing();
@@ -105,26 +120,13 @@ public:
     virtual bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
 
 private:
-    enum CellGroupIteratorDirection { Row, Column, Square };
-    struct CellGroupIterator
-    {
-        CellGroupIteratorDirection direction;
-        int row0, col0;
-        int row, col;
-        int groupIndex;
-
-        static int paramForDirection(CellGroupIteratorDirection direction, int row, int col);
-        static void rowColForIndexInSquare(int index, int square, int &row, int &col);
-        CellGroupIterator(CellGroupIteratorDirection direction, int param);
-        CellGroupIterator(CellGroupIteratorDirection direction, int row, int col);
-        bool atEnd() const;
-        bool next();
-    };
-
     class SetDataUndoCommand : public QUndoCommand
     {
     public:
         SetDataUndoCommand(BoardModel *board, const QModelIndex &index, const QVariant &oldValue, const QVariant &newValue);
+        const QModelIndex &cellIndex() const { return index; }
+        int oldNum() const { return oldValue.toInt(); }
+        int newNum() const { return newValue.toInt(); }
 
     private:
         BoardModel *board;
@@ -136,35 +138,23 @@ private:
         virtual void undo() override;
     };
 
-    bool possibilities[9][9][10];
+    BoardSolver solver;
+    BoardLayout _layout;        // (the solver's state points to it)
     bool possibilitiesInitialised;
+    Bitboard81 givens;
+    bool restoringSession;
+    SolutionCache *solutionCache;
 
-    QModelIndex _flashCellIndex;
+    QList<QModelIndex> _flashCellIndexes;
     QList<FlashPossibilities> _flashPossibilities;
 
-    void setPossibility(int row, int col, int num, bool possible);
+    void possibilitiesChanged(const BoardState &before);
     void resetAllPossibilities();
-    void reducePossibilities(int row, int col);
     void reduceAllPossibilities();
     void clearAllData();
+    void setGivens(const BoardState &puzzle);
     int numInCell(int row, int col) const;
-    bool numInCellHasDuplicate(int row, int col) const;
-    bool cellHasOnePossibility(int row, int col, int &num) const;
-    CellNum solveFindStepPass1() const;
-    CellNum cellGroupOnlyPossibilityForNum(CellGroupIteratorDirection direction, int param) const;
-    CellNum solveFindStepPass2() const;
-    QList<int> numPossibilitiesListForCell(int row, int col) const;
-    QVector<QList<int> > cellGroupPossibilitiesByIndex(CellGroupIteratorDirection direction, int param) const;
-    bool reduceCellGroupPossibilitiesForIdenticalPairs(CellGroupIteratorDirection direction, int param);
-    bool reduceAllGroupPossibilitiesForIdenticalPairs();
-    QList<int> groupIndexPossibilitiesListForNumber(CellGroupIteratorDirection direction, int param, int num) const;
-    QVector<QList<int> > cellGroupPossibilitiesByNumber(CellGroupIteratorDirection direction, int param) const;
-    bool reduceCellGroupPossibilitiesForUniquePairs(CellGroupIteratorDirection direction, int param);
-    bool reduceAllGroupPossibilitiesForUniquePairs();
-    bool reduceRowColumnPossibilitiesForSquare(int param);
-    bool reduceAllRowColumnPossibilitiesForSquares();
-    CellNum solveFindStepPass3();
-    CellNum solveFindStep();
+    CellNum solutionCacheStep();
 
 signals:
     void beginFlashing();
@@ -200,6 +190,8 @@ private:
         }
     };
 
+    friend class GuiBenchmark;
+
     BoardModel *boardModel;
     CellFlasher cellFlasher;
     BoardCellDelegate *cellDelegate;
@@ -232,9 +224,12 @@ public:
     virtual void setModelData(QWidget *editor, QAbstractItemModel *model, const QModelIndex &index) const override;
 
 private:
+    friend class GuiBenchmark;
+
     BoardView *boardView;
     BoardModel *boardModel;
     bool _showPossibilities;
+    mutable int paintCount;     // (for `GuiBenchmark`)
 
     bool isNumToBeFlashed(int num, const QModelIndex &index, const QList<BoardModel::FlashPossibilities> &fps) const;
 
@@ -0,0 +1,287 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "puzzlecorpus.h"
+
+static_assert(sizeof(PuzzleCorpusHeader) == 64, "Puzzle corpus header must be 64 bytes");
+
+static const char corpusMagic[8] = { 'S', 'U', 'D', 'O', 'K', 'U', 'P', 'C' };
+static const uint32_t corpusVersion = 1;
+static const uint32_t gradeSize = 8;
+
+static uint32_t recordSizeForFlags(uint32_t flags)
+{
+    return BoardState::PackedSize
+            + ((flags & CorpusHasSolutions) ? BoardState::PackedSize : 0)
+            + ((flags & CorpusHasGrades) ? gradeSize : 0);
+}
+
+
+////////// STRUCT PuzzleRecordView //////////
+
+void PuzzleRecordView::puzzle(BoardState &state) const
+{
+    state.unpack(data);
+}
+
+bool PuzzleRecordView::solution(BoardState &state) const
+{
+    if (!hasSolution())
+        return false;
+    state.unpack(data + BoardState::PackedSize);
+    return true;
+}
+
+static void packedToText(const uint8_t *packed, char text[81])
+{
+    // the numbers as characters, "0" for an empty cell, straight from the packed bytes
+    for (int cell = 0; cell < 80; cell += 2)
+    {
+        text[cell] = char('0' + (packed[cell / 2] >> 4));
+        text[cell + 1] = char('0' + (packed[cell / 2] & 0xf));
+    }
+    text[80] = char('0' + (packed[40] >> 4));
+}
+
+void PuzzleRecordView::puzzleText(char text[81]) const
+{
+    packedToText(data, text);
+}
+
+bool PuzzleRecordView::solutionText(char text[81]) const
+{
+    // return false if there is no solution field, or it was left empty
+    if (!hasSolution() || data[BoardState::PackedSize] == 0)
+        return false;
+    packedToText(data + BoardState::PackedSize, text);
+    return true;
+}
+
+bool PuzzleRecordView::grade(BoardGrader::Grade &grade) const
+{
+    if (!hasGrade())
+        return false;
+    const uint8_t *gradeData = data + BoardState::PackedSize + (hasSolution() ? BoardState::PackedSize : 0);
+    if (gradeData[0] & 0x80)
+    {
+        grade.hardestPass = BoardGrader::NeedsSearch;
+        grade.solutionCount = gradeData[0] & 0x7f;
+    }
+    else
+    {
+        grade.hardestPass = gradeData[0];
+        grade.solutionCount = 1;
+    }
+    grade.stepCounts[0] = 0;
+    for (int pass = 1; pass <= BoardGrader::PassCount; pass++)
+        grade.stepCounts[pass] = gradeData[pass];
+    grade.rating = gradeData[6] | (gradeData[7] << 8);
+    return true;
+}
+
+
+////////// CLASS PuzzleCorpusReader //////////
+
+PuzzleCorpusReader::PuzzleCorpusReader()
+{
+    mapping = nullptr;
+    mappingSize = 0;
+    records = nullptr;
+    recordSize = 0;
+    _flags = 0;
+    _size = 0;
+}
+
+PuzzleCorpusReader::~PuzzleCorpusReader()
+{
+    close();
+}
+
+/*static*/ bool PuzzleCorpusReader::isCorpusFile(const std::string &path)
+{
+    // return whether a file starts like a corpus file (rather than text)
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(corpusMagic)];
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, corpusMagic, sizeof(magic)) == 0;
+}
+
+void PuzzleCorpusReader::open(const std::string &path)
+{
+    // throw `std::runtime_error` if the file cannot be opened or is not a corpus
+    close();
+    const uint8_t *data = nullptr;
+    size_t dataSize = 0;
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error(path + ": " + std::strerror(errno));
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = buffer.data();
+    dataSize = buffer.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error(path + ": " + std::strerror(errno));
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error(path + ": " + std::strerror(error));
+    }
+    dataSize = size_t(st.st_size);
+    if (dataSize > 0)
+    {
+        void *address = ::mmap(nullptr, dataSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED)
+        {
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error(path + ": " + std::strerror(error));
+        }
+        // records are read in order by each thread, so let the kernel read ahead
+        ::madvise(address, dataSize, MADV_SEQUENTIAL);
+        mapping = static_cast<const uint8_t *>(address);
+        mappingSize = dataSize;
+        data = mapping;
+    }
+    ::close(fd);
+#endif
+
+    PuzzleCorpusHeader header;
+    if (dataSize < sizeof(header))
+    {
+        close();
+        throw std::runtime_error(path + ": not a puzzle corpus file");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, corpusMagic, sizeof(corpusMagic)) != 0 || header.version != corpusVersion
+            || header.recordSize != recordSizeForFlags(header.flags) || header.recordsOffset < sizeof(header)
+            || header.recordsOffset > dataSize || header.recordCount > (dataSize - header.recordsOffset) / header.recordSize)
+    {
+        close();
+        throw std::runtime_error(path + ": not a puzzle corpus file, or it is cut short");
+    }
+    records = data + header.recordsOffset;
+    recordSize = header.recordSize;
+    _flags = header.flags;
+    _size = size_t(header.recordCount);
+}
+
+void PuzzleCorpusReader::close()
+{
+#ifndef _WIN32
+    if (mapping != nullptr)
+        ::munmap(const_cast<uint8_t *>(mapping), mappingSize);
+#endif
+    mapping = nullptr;
+    mappingSize = 0;
+    buffer.clear();
+    records = nullptr;
+    recordSize = 0;
+    _flags = 0;
+    _size = 0;
+}
+
+PuzzleRecordView PuzzleCorpusReader::record(size_t index) const
+{
+    PuzzleRecordView view;
+    view.data = records + index * recordSize;
+    view.flags = _flags;
+    return view;
+}
+
+
+////////// CLASS PuzzleCorpusWriter //////////
+
+PuzzleCorpusWriter::PuzzleCorpusWriter()
+{
+    flags = 0;
+    recordCount = 0;
+}
+
+PuzzleCorpusWriter::~PuzzleCorpusWriter()
+{
+    // (errors closing are lost here, so call `close()` first to see them)
+    try {
+        close();
+    } catch (const std::exception &) {
+    }
+}
+
+void PuzzleCorpusWriter::open(const std::string &path, uint32_t flags)
+{
+    // the header is written blank and only filled in by `close()`
+    // so a corpus cut short by a crash is not taken for a whole one
+    close();
+    this->path = path;
+    this->flags = flags;
+    recordCount = 0;
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error(path + ": " + std::strerror(errno));
+    PuzzleCorpusHeader header;
+    std::memset(&header, 0, sizeof(header));
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+void PuzzleCorpusWriter::append(const BoardState &puzzle, const BoardState *solution /*= nullptr*/, const BoardGrader::Grade *grade /*= nullptr*/)
+{
+    // (a field the corpus has but which is not given is written as zeros)
+    uint8_t record[BoardState::PackedSize * 2 + gradeSize];
+    size_t size = 0;
+    puzzle.pack(record);
+    size += BoardState::PackedSize;
+    if (flags & CorpusHasSolutions)
+    {
+        if (solution != nullptr)
+            solution->pack(record + size);
+        else
+            std::memset(record + size, 0, BoardState::PackedSize);
+        size += BoardState::PackedSize;
+    }
+    if (flags & CorpusHasGrades)
+    {
+        uint8_t *gradeData = record + size;
+        std::memset(gradeData, 0, gradeSize);
+        if (grade != nullptr)
+        {
+            gradeData[0] = uint8_t(grade->hasOneSolution() ? grade->hardestPass : 0x80 | grade->solutionCount);
+            for (int pass = 1; pass <= BoardGrader::PassCount; pass++)
+                gradeData[pass] = uint8_t(grade->stepCounts[pass]);
+            gradeData[6] = uint8_t(grade->rating);
+            gradeData[7] = uint8_t(grade->rating >> 8);
+        }
+        size += gradeSize;
+    }
+    file.write(reinterpret_cast<const char *>(record), std::streamsize(size));
+    recordCount++;
+}
+
+void PuzzleCorpusWriter::close()
+{
+    // throw `std::runtime_error` if anything failed to be written
+    if (!file.is_open())
+        return;
+    PuzzleCorpusHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, corpusMagic, sizeof(corpusMagic));
+    header.version = corpusVersion;
+    header.flags = flags;
+    header.recordCount = recordCount;
+    header.recordSize = recordSizeForFlags(flags);
+    header.recordsOffset = sizeof(header);
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.close();
+    if (!file)
+        throw std::runtime_error(path + ": failed writing puzzle corpus");
+}
@@ -0,0 +1,99 @@
+#ifndef PUZZLECORPUS_H
+#define PUZZLECORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "boardgrader.h"
+#include "boardstate.h"
+
+////////// Puzzle corpus file format //////////
+// a binary file of many puzzles: a 64-byte header and then fixed-size records, so record n is found
+// at `recordsOffset + n * recordSize` without any separate index
+// each record is the puzzle packed by `BoardState::pack()`, then optionally its solution packed the same way,
+// then optionally its grade as 8 bytes: hardest pass, the step counts of passes 1 to 5, and the rating (16 bits)
+// (a puzzle without just one solution has 0x80 plus its solution count, 0 or 2, for its hardest pass)
+// all numbers are little-endian
+
+struct PuzzleCorpusHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t recordCount;
+    uint32_t recordSize;
+    uint32_t recordsOffset;
+    uint8_t reserved[32];
+};
+
+enum PuzzleCorpusFlags { CorpusHasSolutions = 1, CorpusHasGrades = 2 };
+
+
+////////// STRUCT PuzzleRecordView //////////
+// a record of a corpus where it lies in the file's memory, unpacked only when asked
+struct PuzzleRecordView
+{
+    const uint8_t *data;
+    uint32_t flags;
+
+    bool hasSolution() const { return (flags & CorpusHasSolutions) != 0; }
+    bool hasGrade() const { return (flags & CorpusHasGrades) != 0; }
+    void puzzle(BoardState &state) const;
+    bool solution(BoardState &state) const;
+    bool grade(BoardGrader::Grade &grade) const;
+    void puzzleText(char text[81]) const;
+    bool solutionText(char text[81]) const;
+};
+
+
+////////// CLASS PuzzleCorpusReader //////////
+// maps a corpus file into memory read-only, and hands out views of its records
+// the views can be used from any number of threads at once, for as long as the reader is open
+class PuzzleCorpusReader
+{
+public:
+    PuzzleCorpusReader();
+    ~PuzzleCorpusReader();
+
+    static bool isCorpusFile(const std::string &path);
+    void open(const std::string &path);
+    void close();
+
+    uint32_t flags() const { return _flags; }
+    size_t size() const { return _size; }
+    PuzzleRecordView record(size_t index) const;
+
+private:
+    const uint8_t *mapping;
+    size_t mappingSize;
+    std::vector<uint8_t> buffer;    // the whole file, where it cannot be mapped
+    const uint8_t *records;
+    uint32_t recordSize;
+    uint32_t _flags;
+    size_t _size;
+};
+
+
+////////// CLASS PuzzleCorpusWriter //////////
+// writes a corpus file a record at a time
+class PuzzleCorpusWriter
+{
+public:
+    PuzzleCorpusWriter();
+    ~PuzzleCorpusWriter();
+
+    void open(const std::string &path, uint32_t flags);
+    void append(const BoardState &puzzle, const BoardState *solution = nullptr, const BoardGrader::Grade *grade = nullptr);
+    void close();
+
+private:
+    std::string path;
+    std::ofstream file;
+    uint32_t flags;
+    uint64_t recordCount;
+};
+
+#endif // PUZZLECORPUS_H
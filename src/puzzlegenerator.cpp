@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "boardsearch.h"
+#include "puzzlegenerator.h"
+
+
+////////// CLASS PuzzleGenerator //////////
+
+PuzzleGenerator::PuzzleGenerator(uint64_t seed)
+    : random(seed)
+{
+}
+
+void PuzzleGenerator::generate(Puzzle &result)
+{
+    // make a random minimal puzzle, of whatever difficulty
+    BoardSearch::randomSolution(BoardState(), random, result.solution);
+    result.puzzle = result.solution;
+    int cells[81];
+    for (int cell = 0; cell < 81; cell++)
+        cells[cell] = cell;
+    std::shuffle(cells, cells + 81, random);
+    for (int cell : cells)
+    {
+        int num = result.puzzle.nums[cell];
+        result.puzzle.nums[cell] = 0;
+        result.puzzle.resetAllPossibilities();
+        if (BoardSearch::countSolutions(result.puzzle, 2) != 1)
+            result.puzzle.nums[cell] = uint8_t(num);
+    }
+    result.puzzle.resetAllPossibilities();
+    BoardGrader::grade(result.puzzle, result.grade);
+}
+
+bool PuzzleGenerator::generate(int difficulty, int maxAttempts, Puzzle &result)
+{
+    // make random minimal puzzles until one is of the wanted difficulty (or any difficulty if that is 0)
+    // return false if none is within `maxAttempts`
+    for (int attempt = 0; attempt < maxAttempts; attempt++)
+    {
+        generate(result);
+        if (difficulty == 0 || result.grade.hardestPass == difficulty)
+            return true;
+    }
+    return false;
+}
+
+/*static*/ long long PuzzleGenerator::generateMany(long long count, int difficulty, int threadCount, uint64_t seed, const PuzzleCallback &callback)
+{
+    // make `count` puzzles of the wanted difficulty (or any difficulty if that is 0) across `threadCount` threads
+    // each attempt at a puzzle has its own generator, seeded from `seed` and the attempt's number,
+    // and the puzzles are passed on in the order of their attempts, so the same seed makes the same puzzles
+    // however many threads there are
+    // `callback` is called for each puzzle, by one thread at a time, and can return false to stop early
+    // return the number of puzzles made
+    std::mutex mutex;                                       // guards all below
+    std::condition_variable passedOn;
+    long long made = 0;
+    bool stopped = false;
+    long long nextAttempt = 0, nextToPass = 0;
+    std::map<long long, std::unique_ptr<Puzzle>> finished;  // [attempt] the attempts done out of order, null if it failed
+    // (a thread does not run further ahead of the attempts passed on than this, which bounds `finished`)
+    const long long maxAhead = 4 * std::max(threadCount, 1);
+    auto worker = [&]()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            passedOn.wait(lock, [&]() { return stopped || nextAttempt < nextToPass + maxAhead; });
+            if (stopped)
+                return;
+            long long attempt = nextAttempt++;
+            lock.unlock();
+            PuzzleGenerator generator(seed + uint64_t(attempt) * 0x9e3779b97f4a7c15ULL);
+            std::unique_ptr<Puzzle> puzzle(new Puzzle);
+            if (!generator.generate(difficulty, 1, *puzzle))
+                puzzle.reset();
+            lock.lock();
+            finished[attempt] = std::move(puzzle);
+            for (auto it = finished.begin(); !stopped && it != finished.end() && it->first == nextToPass; it = finished.erase(it))
+            {
+                nextToPass++;
+                if (it->second == nullptr)
+                    continue;
+                made++;
+                if (!callback(*it->second) || made >= count)
+                    stopped = true;
+            }
+            passedOn.notify_all();
+        }
+    };
+    if (count <= 0)
+        return 0;
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &thread : threads)
+        thread.join();
+    return made;
+}
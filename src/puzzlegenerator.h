@@ -0,0 +1,35 @@
+#ifndef PUZZLEGENERATOR_H
+#define PUZZLEGENERATOR_H
+
+#include <cstdint>
+#include <functional>
+#include <random>
+
+#include "boardgrader.h"
+#include "boardstate.h"
+
+////////// CLASS PuzzleGenerator //////////
+// makes new puzzles: starting from a random complete board, clues are taken away in random order
+// as long as the puzzle still has just one solution, which leaves a "minimal" puzzle
+// a puzzle's difficulty is the hardest pass of `BoardSolver::solveFindStep()` needed to solve it (see `BoardGrader`)
+class PuzzleGenerator
+{
+public:
+    struct Puzzle
+    {
+        BoardState puzzle, solution;
+        BoardGrader::Grade grade;
+    };
+    typedef std::function<bool(const Puzzle &puzzle)> PuzzleCallback;
+
+    PuzzleGenerator(uint64_t seed);
+
+    void generate(Puzzle &result);
+    bool generate(int difficulty, int maxAttempts, Puzzle &result);
+    static long long generateMany(long long count, int difficulty, int threadCount, uint64_t seed, const PuzzleCallback &callback);
+
+private:
+    std::mt19937_64 random;
+};
+
+#endif // PUZZLEGENERATOR_H
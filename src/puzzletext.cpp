@@ -0,0 +1,225 @@
+#include <cstring>
+
+#include "puzzletext.h"
+
+
+////////// CLASS PuzzleTextParser //////////
+
+PuzzleTextParser::PuzzleTextParser()
+{
+    pos = end = nullptr;
+    _lineNumber = 0;
+    _errorMessage = nullptr;
+    savesRows = 0;
+}
+
+PuzzleTextParser::PuzzleTextParser(const char *text, size_t size)
+    : PuzzleTextParser()
+{
+    setText(text, size);
+}
+
+void PuzzleTextParser::setText(const char *text, size_t size)
+{
+    // start on the next block of text (line numbers carry on)
+    pos = text;
+    end = text + size;
+}
+
+bool PuzzleTextParser::nextLine(const char *&line, size_t &length)
+{
+    // the next line, without its "\n" or "\r\n"
+    if (pos >= end)
+        return false;
+    line = pos;
+    const char *newline = static_cast<const char *>(std::memchr(pos, '\n', size_t(end - pos)));
+    const char *lineEnd = newline ? newline : end;
+    pos = newline ? newline + 1 : end;
+    if (lineEnd > line && lineEnd[-1] == '\r')
+        lineEnd--;
+    length = size_t(lineEnd - line);
+    _lineNumber++;
+    return true;
+}
+
+/*static*/ bool PuzzleTextParser::isBlankOrComment(const char *line, size_t length)
+{
+    size_t i = 0;
+    while (i < length && (line[i] == ' ' || line[i] == '\t'))
+        i++;
+    if (i == length)
+        return true;
+    return line[i] == '#' || line[i] == ';' || (line[i] == '/' && i + 1 < length && line[i + 1] == '/');
+}
+
+/*static*/ bool PuzzleTextParser::parseLine(const char *line, size_t length, BoardState &state)
+{
+    // parse a line of 81 characters, "1" to "9" for a number and "0" or "." for an empty cell
+    // which may be followed by whitespace and anything else
+    // return false if the line is not in that form
+    if (!parseLineNums(line, length, state.nums))
+        return false;
+    state.resetAllPossibilities();
+    return true;
+}
+
+/*static*/ bool PuzzleTextParser::parseLineNums(const char *line, size_t length, uint8_t nums[81])
+{
+    // as `parseLine()`, into just the numbers (for when there are far too many boards to give each a `BoardState`)
+    if (length < 81 || (length > 81 && line[81] != ' ' && line[81] != '\t'))
+        return false;
+    for (int cell = 0; cell < 81; cell++)
+    {
+        char ch = line[cell];
+        if (ch >= '0' && ch <= '9')
+            nums[cell] = uint8_t(ch - '0');
+        else if (ch == '.')
+            nums[cell] = 0;
+        else
+            return false;
+    }
+    return true;
+}
+
+/*static*/ const char *PuzzleTextParser::parseSavesRow(const char *line, size_t length, uint8_t nums[9])
+{
+    // parse a row of the saves/ format, 9 numbers from 0 to 9 separated by spaces
+    // return an error message, or null if it is good
+    int count = 0;
+    size_t i = 0;
+    for (;;)
+    {
+        while (i < length && (line[i] == ' ' || line[i] == '\t'))
+            i++;
+        if (i == length)
+            break;
+        if (count == 9)
+            return "Incorrect number of elements in line";
+        int num = 0;
+        size_t start = i;
+        while (i < length && line[i] >= '0' && line[i] <= '9' && num <= 9)
+            num = num * 10 + (line[i++] - '0');
+        if (i == start || (i < length && line[i] != ' ' && line[i] != '\t'))
+            return "Bad number in file";
+        if (num > 9)
+            return "Bad number in file";
+        nums[count++] = uint8_t(num);
+    }
+    return (count == 9) ? nullptr : "Incorrect number of elements in line";
+}
+
+PuzzleTextParser::Result PuzzleTextParser::next(BoardState &state)
+{
+    // parse the next puzzle into `state`
+    // return `End` at the end of the text, or `Error` (with `errorMessage()` and `lineNumber()` saying why and where)
+    if (_errorMessage != nullptr)
+        return Error;
+    const char *line;
+    size_t length;
+    while (nextLine(line, length))
+    {
+        if (savesRows == 0)
+        {
+            if (isBlankOrComment(line, length))
+                continue;
+            if (parseLine(line, length, state))
+                return Parsed;
+        }
+        _errorMessage = parseSavesRow(line, length, &saves.nums[savesRows * 9]);
+        if (_errorMessage != nullptr)
+            return Error;
+        if (++savesRows == 9)
+        {
+            savesRows = 0;
+            std::memcpy(state.nums, saves.nums, sizeof(state.nums));
+            state.resetAllPossibilities();
+            return Parsed;
+        }
+    }
+    return End;
+}
+
+PuzzleTextParser::Result PuzzleTextParser::finish()
+{
+    // call at the end of all the text, to check it did not stop part way through a puzzle
+    if (_errorMessage == nullptr && savesRows != 0)
+        _errorMessage = "Too few lines in file";
+    return (_errorMessage != nullptr) ? Error : End;
+}
+
+
+////////// CLASS PuzzleTextWriter //////////
+
+PuzzleTextWriter::PuzzleTextWriter(std::ostream &out, size_t bufferSize /*= size_t(1) << 20*/)
+    : out(out), buffer(bufferSize)
+{
+    used = 0;
+}
+
+PuzzleTextWriter::~PuzzleTextWriter()
+{
+    flush();
+}
+
+char *PuzzleTextWriter::reserve(size_t size)
+{
+    // return room for `size` more bytes at the end of the buffer, writing out what is there first if need be
+    if (used + size > buffer.size())
+    {
+        flush();
+        if (size > buffer.size())
+            buffer.resize(size);
+    }
+    char *room = buffer.data() + used;
+    used += size;
+    return room;
+}
+
+void PuzzleTextWriter::flush()
+{
+    if (used > 0)
+        out.write(buffer.data(), std::streamsize(used));
+    used = 0;
+}
+
+void PuzzleTextWriter::write(const char *text, size_t size)
+{
+    std::memcpy(reserve(size), text, size);
+}
+
+void PuzzleTextWriter::writeLine(const char *text, size_t size)
+{
+    char *room = reserve(size + 1);
+    std::memcpy(room, text, size);
+    room[size] = '\n';
+}
+
+void PuzzleTextWriter::writeBoardLine(const BoardState &state)
+{
+    // 81 characters ("0" for an empty cell) and a newline
+    char *room = reserve(82);
+    for (int cell = 0; cell < 81; cell++)
+        room[cell] = char('0' + state.nums[cell]);
+    room[81] = '\n';
+}
+
+void PuzzleTextWriter::writeBoardSaves(const BoardState &state)
+{
+    // 9 lines of 9 numbers each followed by a space, as `BoardModel::saveBoard()` writes
+    char *room = reserve(9 * 19);
+    for (int row = 0; row < 9; row++, room += 19)
+    {
+        for (int col = 0; col < 9; col++)
+        {
+            room[col * 2] = char('0' + state.nums[row * 9 + col]);
+            room[col * 2 + 1] = ' ';
+        }
+        room[18] = '\n';
+    }
+}
+
+void PuzzleTextWriter::writeBoardPacked(const BoardState &state)
+{
+    // `BoardState::pack()`'s 41 bytes
+    state.pack(reinterpret_cast<uint8_t *>(reserve(BoardState::PackedSize)));
+}
@@ -0,0 +1,73 @@
+#ifndef PUZZLETEXT_H
+#define PUZZLETEXT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "boardstate.h"
+
+////////// CLASS PuzzleTextParser //////////
+// parses puzzles straight out of text in memory, without allocating or copying
+// it takes, in any mix:
+// - 81-character lines, "1" to "9" for a number and "0" or "." for an empty cell,
+//   optionally followed by whitespace and anything else (e.g. a grade)
+// - the saves/ format, 9 lines of 9 numbers separated by spaces, 0 for an empty cell
+// - blank lines, and comment or header lines starting with "#", ";" or "//"
+// it checks the text as it goes and stops at the first line it cannot take
+// text can be given a block at a time (each ending at the end of a line), a saves/ puzzle may run on into the next block
+class PuzzleTextParser
+{
+public:
+    enum Result { Parsed, End, Error };
+
+    PuzzleTextParser();
+    PuzzleTextParser(const char *text, size_t size);
+
+    void setText(const char *text, size_t size);
+    Result next(BoardState &state);
+    Result finish();
+    size_t lineNumber() const { return _lineNumber; }
+    const char *errorMessage() const { return _errorMessage; }
+
+    static bool parseLine(const char *line, size_t length, BoardState &state);
+    static bool parseLineNums(const char *line, size_t length, uint8_t nums[81]);
+
+private:
+    const char *pos, *end;
+    size_t _lineNumber;
+    const char *_errorMessage;
+    BoardState saves;
+    int savesRows;
+
+    bool nextLine(const char *&line, size_t &length);
+    static bool isBlankOrComment(const char *line, size_t length);
+    static const char *parseSavesRow(const char *line, size_t length, uint8_t nums[9]);
+};
+
+
+////////// CLASS PuzzleTextWriter //////////
+// formats boards straight into a large buffer, and writes that out to a stream only when it is full
+class PuzzleTextWriter
+{
+public:
+    PuzzleTextWriter(std::ostream &out, size_t bufferSize = size_t(1) << 20);
+    ~PuzzleTextWriter();
+
+    void write(const char *text, size_t size);
+    void writeLine(const char *text, size_t size);
+    void writeBoardLine(const BoardState &state);
+    void writeBoardSaves(const BoardState &state);
+    void writeBoardPacked(const BoardState &state);
+    void flush();
+
+private:
+    std::ostream &out;
+    std::vector<char> buffer;
+    size_t used;
+
+    char *reserve(size_t size);
+};
+
+#endif // PUZZLETEXT_H
@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <cstring>
+
+#include "boardlayout.h"
+#include "sessionmanager.h"
+
+
+////////// CLASS SessionManager //////////
+
+SessionManager::SessionManager()
+{
+    lastId = 0;
+}
+
+SessionManager::Session *SessionManager::allocateSession()
+{
+    // a slot from the slab for a session, reusing a free one if there is one (`mutex` must be held)
+    // the caller fills it in holding its lock, setting its id last, as a call which found the slot before it was freed
+    // may still be about to lock it and check the id
+    Session *session;
+    if (!freeSessions.empty())
+    {
+        session = freeSessions.back();
+        freeSessions.pop_back();
+    }
+    else
+    {
+        slab.emplace_back();
+        session = &slab.back();
+    }
+    return session;
+}
+
+SessionManager::Session *SessionManager::residentSession(SessionId id)
+{
+    // the slot of a session, bringing it back into the slab if it was evicted, or null if there is no such session
+    // (`mutex` must be held)
+    auto it = resident.find(id);
+    if (it != resident.end())
+        return it->second;
+    auto evictedIt = evicted.find(id);
+    if (evictedIt == evicted.end())
+        return nullptr;
+    Session *session = allocateSession();
+    {
+        std::lock_guard<std::mutex> sessionLock(session->mutex);
+        deserialise(evictedIt->second, *session);
+        session->id = id;
+    }
+    resident[id] = session;
+    evicted.erase(evictedIt);
+    return session;
+}
+
+bool SessionManager::withSession(SessionId id, const std::function<void(Session &session)> &work)
+{
+    // do some work on a session holding its lock, but not the manager's, so that other sessions can go on meanwhile
+    // the slot may be evicted or freed between finding it and locking it, in which case it is looked up again
+    // return false if there is no such session
+    for (;;)
+    {
+        Session *session;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            session = residentSession(id);
+        }
+        if (session == nullptr)
+            return false;
+        std::lock_guard<std::mutex> sessionLock(session->mutex);
+        if (session->id != id)
+            continue;
+        session->lastUsed = Clock::now();
+        work(*session);
+        return true;
+    }
+}
+
+SessionManager::SessionId SessionManager::create(const BoardState &puzzle)
+{
+    // a new session on a puzzle, whose numbers are its givens
+    // return 0 if the puzzle is not on the standard board
+    if (!puzzle.layout->isStandard())
+        return 0;
+    std::lock_guard<std::mutex> lock(mutex);
+    Session *session = allocateSession();
+    std::lock_guard<std::mutex> sessionLock(session->mutex);
+    session->state = puzzle;
+    session->state.resetAllPossibilities();
+    session->givens = Bitboard81();
+    for (int cell = 0; cell < 81; cell++)
+        if (puzzle.nums[cell] != 0)
+            session->givens.set(cell);
+    session->possibilitiesInitialised = false;
+    session->editCount = session->doneCount = 0;
+    session->lastUsed = Clock::now();
+    session->id = ++lastId;
+    resident[session->id] = session;
+    return session->id;
+}
+
+bool SessionManager::remove(SessionId id)
+{
+    // (waits for any call on the session to finish, which does not need `mutex`, so cannot be waiting on this)
+    std::lock_guard<std::mutex> lock(mutex);
+    if (evicted.erase(id) > 0)
+        return true;
+    auto it = resident.find(id);
+    if (it == resident.end())
+        return false;
+    Session *session = it->second;
+    std::lock_guard<std::mutex> sessionLock(session->mutex);
+    session->id = 0;
+    resident.erase(it);
+    freeSessions.push_back(session);
+    return true;
+}
+
+bool SessionManager::board(SessionId id, BoardState &state, Bitboard81 *givens /*= nullptr*/)
+{
+    // the board as it is now, possibilities and all, and which cells are givens
+    return withSession(id, [&](Session &session)
+    {
+        state = session.state;
+        if (givens != nullptr)
+            *givens = session.givens;
+    });
+}
+
+/*static*/ CellNum SessionManager::findStep(Session &session, BoardSolver &solver)
+{
+    // as `BoardModel::solveStep()`: the next step by logic, keeping the possibilities the solver has reduced
+    solver.state = session.state;
+    if (!session.possibilitiesInitialised)
+    {
+        solver.resetAllPossibilities();
+        solver.reduceAllPossibilities();
+        session.possibilitiesInitialised = true;
+    }
+    CellNum cellNum = solver.solveFindStep();
+    session.state = solver.state;
+    return cellNum;
+}
+
+bool SessionManager::hint(SessionId id, CellNum &cellNum)
+{
+    // the next step, without taking it (`cellNum` is empty if logic finds none)
+    return withSession(id, [&](Session &session)
+    {
+        BoardSolver solver;
+        cellNum = findStep(session, solver);
+    });
+}
+
+bool SessionManager::step(SessionId id, CellNum &cellNum)
+{
+    // take the next step (as in the GUI, a solver step is not an edit to undo)
+    return withSession(id, [&](Session &session)
+    {
+        BoardSolver solver;
+        cellNum = findStep(session, solver);
+        if (cellNum.isEmpty())
+            return;
+        solver.placeNum(cellNum.row, cellNum.col, cellNum.num);
+        session.state = solver.state;
+    });
+}
+
+/*static*/ void SessionManager::setNum(Session &session, int cell, int num)
+{
+    // as an edit in the GUI: the possibilities start again
+    session.state.nums[cell] = uint8_t(num);
+    session.state.resetAllPossibilities();
+    session.possibilitiesInitialised = false;
+}
+
+bool SessionManager::edit(SessionId id, int row, int col, int num)
+{
+    // put a number (0 to clear it) in a cell, as an edit which can be undone; any edits undone can no longer be redone
+    // return false if there is no such session, or the edit is out of range or changes nothing
+    if (row < 0 || row >= 9 || col < 0 || col >= 9 || num < 0 || num > 9)
+        return false;
+    bool edited = false;
+    return withSession(id, [&](Session &session)
+    {
+        int cell = row * 9 + col;
+        if (session.state.nums[cell] == num)
+            return;
+        if (session.doneCount == MaxEdits)
+        {
+            std::copy(session.edits + 1, session.edits + MaxEdits, session.edits);
+            session.doneCount--;
+        }
+        Edit &edit(session.edits[session.doneCount++]);
+        edit.cell = uint8_t(cell);
+        edit.oldNum = session.state.nums[cell];
+        edit.newNum = uint8_t(num);
+        session.editCount = session.doneCount;
+        setNum(session, cell, num);
+        edited = true;
+    }) && edited;
+}
+
+bool SessionManager::undo(SessionId id)
+{
+    // return false if there is no such session or nothing to undo
+    bool undone = false;
+    return withSession(id, [&](Session &session)
+    {
+        if (session.doneCount == 0)
+            return;
+        const Edit &edit(session.edits[--session.doneCount]);
+        setNum(session, edit.cell, edit.oldNum);
+        undone = true;
+    }) && undone;
+}
+
+bool SessionManager::redo(SessionId id)
+{
+    // return false if there is no such session or nothing to redo
+    bool redone = false;
+    return withSession(id, [&](Session &session)
+    {
+        if (session.doneCount == session.editCount)
+            return;
+        const Edit &edit(session.edits[session.doneCount++]);
+        setNum(session, edit.cell, edit.newNum);
+        redone = true;
+    }) && redone;
+}
+
+size_t SessionManager::evictIdle(std::chrono::milliseconds idleTime)
+{
+    // serialise every session not used for `idleTime`, freeing its slot; return how many were evicted
+    // a session busy in a call is not idle, and is passed over without waiting for it
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point idleSince(Clock::now() - idleTime);
+    size_t count = 0;
+    for (auto it = resident.begin(); it != resident.end(); )
+    {
+        Session *session = it->second;
+        std::unique_lock<std::mutex> sessionLock(session->mutex, std::try_to_lock);
+        if (!sessionLock.owns_lock() || session->lastUsed > idleSince)
+        {
+            ++it;
+            continue;
+        }
+        evicted[session->id] = serialise(*session);
+        session->id = 0;
+        freeSessions.push_back(session);
+        it = resident.erase(it);
+        count++;
+    }
+    return count;
+}
+
+size_t SessionManager::sessionCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return resident.size() + evicted.size();
+}
+
+size_t SessionManager::residentCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return resident.size();
+}
+
+/*static*/ std::string SessionManager::serialise(const Session &session)
+{
+    // the numbers packed 2 to a byte, the givens, the edits and whether the possibilities are initialised,
+    // and then the possibilities only if they are (otherwise they are just reset), in about 100 bytes for most sessions
+    std::string data;
+    uint8_t packed[BoardState::PackedSize];
+    session.state.pack(packed);
+    data.append(reinterpret_cast<const char *>(packed), sizeof(packed));
+    data.append(reinterpret_cast<const char *>(&session.givens.lo), sizeof(session.givens.lo));
+    data.append(reinterpret_cast<const char *>(&session.givens.hi), sizeof(session.givens.hi));
+    data += char(session.editCount);
+    data += char(session.doneCount);
+    data.append(reinterpret_cast<const char *>(session.edits), session.editCount * sizeof(Edit));
+    data += char(session.possibilitiesInitialised);
+    if (session.possibilitiesInitialised)
+        data.append(reinterpret_cast<const char *>(session.state.cellPossibilities), sizeof(session.state.cellPossibilities));
+    return data;
+}
+
+/*static*/ void SessionManager::deserialise(const std::string &data, Session &session)
+{
+    // (the data is only ever what `serialise()` made, so it is not checked)
+    const char *pos = data.data();
+    uint8_t packed[BoardState::PackedSize];
+    std::memcpy(packed, pos, sizeof(packed));
+    pos += sizeof(packed);
+    session.state = BoardState();
+    session.state.unpack(packed);
+    std::memcpy(&session.givens.lo, pos, sizeof(session.givens.lo));
+    pos += sizeof(session.givens.lo);
+    std::memcpy(&session.givens.hi, pos, sizeof(session.givens.hi));
+    pos += sizeof(session.givens.hi);
+    session.editCount = uint8_t(*pos++);
+    session.doneCount = uint8_t(*pos++);
+    std::memcpy(session.edits, pos, session.editCount * sizeof(Edit));
+    pos += session.editCount * sizeof(Edit);
+    session.possibilitiesInitialised = (*pos++ != 0);
+    if (session.possibilitiesInitialised)
+    {
+        uint16_t possibilities[81];
+        std::memcpy(possibilities, pos, sizeof(possibilities));
+        session.state.setAllPossibilities(possibilities);
+    }
+    else
+        session.state.resetAllPossibilities();
+    session.lastUsed = Clock::now();
+}
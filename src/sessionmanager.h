@@ -0,0 +1,81 @@
+#ifndef SESSIONMANAGER_H
+#define SESSIONMANAGER_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "boardsolver.h"
+
+////////// CLASS SessionManager //////////
+// holds many interactive solving sessions in one process, for a service rather than the GUI
+// each session is what `BoardModel` keeps of a board, as a compact value of a few hundred bytes in a pooled slab:
+// the numbers, the possibilities as the solver has reduced them, the givens and a log of the edits to undo and redo
+// every call may come from any thread: calls on the same session take turns on its own lock, other sessions' go on at once
+// sessions left idle can be evicted to a serialised form, and come back by themselves the next time they are used
+// only the standard board is held (`create()` refuses others), as a session keeps no layout of its own for its board to point to
+class SessionManager
+{
+public:
+    typedef uint64_t SessionId;     // (never 0)
+    enum { MaxEdits = 64 };         // edits kept to undo, the oldest being forgotten beyond that
+
+    SessionManager();
+
+    SessionId create(const BoardState &puzzle);
+    bool remove(SessionId id);
+    bool board(SessionId id, BoardState &state, Bitboard81 *givens = nullptr);
+    bool hint(SessionId id, CellNum &cellNum);
+    bool step(SessionId id, CellNum &cellNum);
+    bool edit(SessionId id, int row, int col, int num);
+    bool undo(SessionId id);
+    bool redo(SessionId id);
+
+    size_t evictIdle(std::chrono::milliseconds idleTime);
+    size_t sessionCount();
+    size_t residentCount();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Edit
+    {
+        uint8_t cell, oldNum, newNum;
+    };
+
+    struct Session
+    {
+        SessionId id;               // 0 while the slot is free (guarded by `mutex` and `SessionManager::mutex`)
+        std::mutex mutex;
+        BoardState state;
+        Bitboard81 givens;
+        bool possibilitiesInitialised;
+        uint8_t editCount, doneCount;
+        Edit edits[MaxEdits];
+        Clock::time_point lastUsed;
+
+        Session() { id = 0; }
+    };
+
+    std::mutex mutex;               // guards all below
+    SessionId lastId;
+    std::deque<Session> slab;
+    std::vector<Session *> freeSessions;
+    std::unordered_map<SessionId, Session *> resident;
+    std::unordered_map<SessionId, std::string> evicted;
+
+    Session *allocateSession();
+    Session *residentSession(SessionId id);
+    bool withSession(SessionId id, const std::function<void(Session &session)> &work);
+    static CellNum findStep(Session &session, BoardSolver &solver);
+    static void setNum(Session &session, int cell, int num);
+    static std::string serialise(const Session &session);
+    static void deserialise(const std::string &data, Session &session);
+};
+
+#endif // SESSIONMANAGER_H
@@ -0,0 +1,337 @@
+#ifndef SIZEDBOARD_H
+#define SIZEDBOARD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "bitboard.h"
+
+// boards of other sizes than 9x9, with the geometry a template parameter: the size of a box (2, 3, 4 or 5)
+// so a 4x4, 9x9, 16x16 or 25x25 board each gets its own tables and mask width fixed at compile time
+// these are just for the exhaustive search (the logical solver and the GUI are 9x9 only)
+// a board is written as one line of its cells, "0" or "." for an empty cell, "1"-"9" then "A"... for 10 on
+
+////////// STRUCT BoardGeometry //////////
+template<int BoxSize>
+struct BoardGeometry
+{
+    static_assert(BoxSize >= 2 && BoxSize <= 5, "Board box size must be 2 to 5");
+
+    enum
+    {
+        Size = BoxSize * BoxSize,
+        CellCount = Size * Size,
+        UnitCount = Size * 3,
+        PeerCount = (Size - 1) * 2 + (BoxSize - 1) * (BoxSize - 1)
+    };
+    // bit (num - 1) is set if num is possible, so 16 numbers still fit in 16 bits
+    typedef typename std::conditional<(Size <= 16), uint16_t, uint32_t>::type Mask;
+    static Mask allNums() { return Mask((uint64_t(1) << Size) - 1); }
+
+    struct Tables
+    {
+        uint16_t units[UnitCount][Size];        // the cells of each row, column and box
+        uint16_t peers[CellCount][PeerCount];   // the other cells sharing a unit with each cell
+    };
+
+    static const Tables &tables()
+    {
+        static const Tables tables = []()
+        {
+            Tables tables;
+            for (int i = 0; i < Size; i++)
+                for (int j = 0; j < Size; j++)
+                {
+                    tables.units[i][j] = uint16_t(i * Size + j);
+                    tables.units[Size + i][j] = uint16_t(j * Size + i);
+                    int boxRow = i / BoxSize * BoxSize, boxCol = i % BoxSize * BoxSize;
+                    tables.units[Size * 2 + i][j] = uint16_t((boxRow + j / BoxSize) * Size + boxCol + j % BoxSize);
+                }
+            for (int cell = 0; cell < CellCount; cell++)
+            {
+                int row = cell / Size, col = cell % Size, count = 0;
+                for (int cell2 = 0; cell2 < CellCount; cell2++)
+                {
+                    int row2 = cell2 / Size, col2 = cell2 % Size;
+                    bool sameBox = (row / BoxSize == row2 / BoxSize && col / BoxSize == col2 / BoxSize);
+                    if (cell2 != cell && (row2 == row || col2 == col || sameBox))
+                        tables.peers[cell][count++] = uint16_t(cell2);
+                }
+            }
+            return tables;
+        }();
+        return tables;
+    }
+};
+
+inline int boardLineBoxSize(const char *line, size_t length)
+{
+    // the box size of the board on a line, from how many cells there are up to the first space, or 0 if none fits
+    size_t cellCount = 0;
+    while (cellCount < length && line[cellCount] != ' ' && line[cellCount] != '\t' && line[cellCount] != '\r' && line[cellCount] != '\n')
+        cellCount++;
+    for (int boxSize = 2; boxSize <= 5; boxSize++)
+        if (cellCount == size_t(boxSize * boxSize * boxSize * boxSize))
+            return boxSize;
+    return 0;
+}
+
+
+////////// STRUCT SizedBoardState //////////
+template<int BoxSize>
+struct SizedBoardState
+{
+    typedef BoardGeometry<BoxSize> Geometry;
+    typedef typename Geometry::Mask Mask;
+
+    uint8_t nums[Geometry::CellCount];
+    Mask cellPossibilities[Geometry::CellCount];
+
+    SizedBoardState() { clear(); }
+
+    void clear()
+    {
+        std::memset(nums, 0, sizeof(nums));
+        for (Mask &mask : cellPossibilities)
+            mask = Geometry::allNums();
+    }
+
+    void place(int cell, int num)
+    {
+        // put a number in a cell and take it out of the possibilities of the cell's peers
+        const uint16_t *peers = Geometry::tables().peers[cell];
+        Mask bit = Mask(Mask(1) << (num - 1));
+        nums[cell] = uint8_t(num);
+        cellPossibilities[cell] = 0;
+        for (int i = 0; i < Geometry::PeerCount; i++)
+            cellPossibilities[peers[i]] &= Mask(~bit);
+    }
+
+    bool parse(const char *line, size_t length)
+    {
+        // parse a board from a line; return false if it is not a board of this size
+        if (boardLineBoxSize(line, length) != BoxSize)
+            return false;
+        clear();
+        for (int cell = 0; cell < Geometry::CellCount; cell++)
+        {
+            char ch = line[cell];
+            int num;
+            if (ch == '.' || ch == '0')
+                continue;
+            else if (ch >= '1' && ch <= '9')
+                num = ch - '0';
+            else if (ch >= 'A' && ch <= 'Z')
+                num = ch - 'A' + 10;
+            else if (ch >= 'a' && ch <= 'z')
+                num = ch - 'a' + 10;
+            else
+                return false;
+            if (num > Geometry::Size)
+                return false;
+            place(cell, num);
+        }
+        return true;
+    }
+
+    bool hasDuplicates() const
+    {
+        // whether any unit has a number in it twice
+        const typename Geometry::Tables &tables(Geometry::tables());
+        for (int unit = 0; unit < Geometry::UnitCount; unit++)
+        {
+            Mask placed = 0;
+            for (int i = 0; i < Geometry::Size; i++)
+            {
+                int num = nums[tables.units[unit][i]];
+                if (num == 0)
+                    continue;
+                Mask bit = Mask(Mask(1) << (num - 1));
+                if ((placed & bit) != 0)
+                    return true;
+                placed |= bit;
+            }
+        }
+        return false;
+    }
+
+    std::string toString() const
+    {
+        std::string str(Geometry::CellCount, '0');
+        for (int cell = 0; cell < Geometry::CellCount; cell++)
+            str[cell] = char((nums[cell] <= 9) ? '0' + nums[cell] : 'A' + nums[cell] - 10);
+        return str;
+    }
+};
+
+
+////////// CLASS SizedBoardSearch //////////
+// as `BoardSearch::countSolutions()`, for a board of any size
+// each node places all the naked and hidden singles it can, then guesses in a cell with the fewest possibilities
+template<int BoxSize>
+class SizedBoardSearch
+{
+public:
+    typedef SizedBoardState<BoxSize> State;
+    typedef BoardGeometry<BoxSize> Geometry;
+    typedef typename Geometry::Mask Mask;
+
+    static int countSolutions(const State &state, int limit, State *solution = nullptr)
+    {
+        // count the solutions of a board, up to `limit`, filling in `solution` with the first (if not null)
+        int count = 0;
+        State start(state);
+        if (!state.hasDuplicates() && propagate(start))
+            countSolutionsFrom(start, limit, count, solution);
+        return count;
+    }
+
+private:
+    static bool propagate(State &state)
+    {
+        // place singles until there are none left, removing locked candidates when there are none
+        // return false if the board cannot be solved
+        const typename Geometry::Tables &tables(Geometry::tables());
+        bool changed;
+        do
+        {
+            changed = false;
+            for (int cell = 0; cell < Geometry::CellCount; cell++)
+            {
+                if (state.nums[cell] != 0)
+                    continue;
+                Mask mask = state.cellPossibilities[cell];
+                if (mask == 0)
+                    return false;
+                if ((mask & (mask - 1)) == 0)
+                {
+                    state.place(cell, lowestBit64(mask) + 1);
+                    changed = true;
+                }
+            }
+            for (int unit = 0; unit < Geometry::UnitCount; unit++)
+            {
+                // the numbers possible in exactly one cell of the unit, and those already placed in it
+                Mask once = 0, twice = 0, placed = 0;
+                for (int i = 0; i < Geometry::Size; i++)
+                {
+                    int cell = tables.units[unit][i];
+                    Mask mask = state.cellPossibilities[cell];
+                    twice |= once & mask;
+                    once |= mask;
+                    if (state.nums[cell] != 0)
+                        placed |= Mask(Mask(1) << (state.nums[cell] - 1));
+                }
+                if (Mask(once | placed) != Geometry::allNums())
+                    return false;
+                once &= Mask(~twice);
+                for (; once != 0; once &= Mask(once - 1))
+                {
+                    Mask bit = Mask(once & Mask(~(once - 1)));
+                    for (int i = 0; i < Geometry::Size; i++)
+                    {
+                        int cell = tables.units[unit][i];
+                        if ((state.cellPossibilities[cell] & bit) != 0)
+                        {
+                            state.place(cell, lowestBit64(bit) + 1);
+                            changed = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            if (!changed)
+                changed = reduceLockedCandidates(state);
+        } while (changed);
+        return true;
+    }
+
+    static int cellInLine(int direction, int line, int index)
+    {
+        // the cell at `index` along a row (direction 0) or column (direction 1)
+        return (direction == 0) ? line * Geometry::Size + index : index * Geometry::Size + line;
+    }
+
+    static bool reduceLockedCandidates(State &state)
+    {
+        // where a number's possibilities in a box all lie in one row (or column) it cannot be elsewhere in that row ("pointing")
+        // where its possibilities in a row (or column) all lie in one box it cannot be elsewhere in that box ("claiming")
+        // each row or column is cut into segments, one per box it crosses
+        // return whether any possibilities were removed
+        bool changed = false;
+        Mask segments[Geometry::Size][BoxSize];
+        for (int direction = 0; direction < 2; direction++)
+        {
+            for (int line = 0; line < Geometry::Size; line++)
+                for (int segment = 0; segment < BoxSize; segment++)
+                {
+                    Mask mask = 0;
+                    for (int i = 0; i < BoxSize; i++)
+                        mask |= state.cellPossibilities[cellInLine(direction, line, segment * BoxSize + i)];
+                    segments[line][segment] = mask;
+                }
+            // (segments other than the one looked at may have had possibilities removed since, and are then too big
+            // which can only make for fewer removals, never wrong ones)
+            for (int line = 0; line < Geometry::Size; line++)
+                for (int segment = 0; segment < BoxSize; segment++)
+                {
+                    int firstLine = line / BoxSize * BoxSize;
+                    Mask elsewhereInLine = 0, elsewhereInBox = 0;
+                    for (int other = 0; other < BoxSize; other++)
+                    {
+                        if (other != segment)
+                            elsewhereInLine |= segments[line][other];
+                        if (firstLine + other != line)
+                            elsewhereInBox |= segments[firstLine + other][segment];
+                    }
+                    Mask pointing = segments[line][segment] & Mask(~elsewhereInBox) & elsewhereInLine;
+                    Mask claiming = segments[line][segment] & Mask(~elsewhereInLine) & elsewhereInBox;
+                    for (int other = 0; other < BoxSize && (pointing | claiming) != 0; other++)
+                        for (int i = 0; i < BoxSize; i++)
+                        {
+                            if (other != segment && pointing != 0)
+                                state.cellPossibilities[cellInLine(direction, line, other * BoxSize + i)] &= Mask(~pointing);
+                            if (firstLine + other != line && claiming != 0)
+                                state.cellPossibilities[cellInLine(direction, firstLine + other, segment * BoxSize + i)] &= Mask(~claiming);
+                        }
+                    changed |= ((pointing | claiming) != 0);
+                }
+        }
+        return changed;
+    }
+
+    static void countSolutionsFrom(const State &state, int limit, int &count, State *solution)
+    {
+        // (state has been propagated)
+        int bestCell = -1, bestCount = Geometry::Size + 1;
+        for (int cell = 0; cell < Geometry::CellCount && bestCount > 2; cell++)
+            if (state.nums[cell] == 0)
+            {
+                int possible = bitCount64(state.cellPossibilities[cell]);
+                if (possible < bestCount)
+                {
+                    bestCell = cell;
+                    bestCount = possible;
+                }
+            }
+        if (bestCell < 0)
+        {
+            if (count++ == 0 && solution != nullptr)
+                *solution = state;
+            return;
+        }
+
+        for (Mask mask = state.cellPossibilities[bestCell]; mask != 0 && count < limit; mask &= Mask(mask - 1))
+        {
+            State next(state);
+            next.place(bestCell, lowestBit64(mask) + 1);
+            if (propagate(next))
+                countSolutionsFrom(next, limit, count, solution);
+        }
+    }
+};
+
+#endif // SIZEDBOARD_H
@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "boardcanonicaliser.h"
+#include "boardsearch.h"
+#include "solutioncache.h"
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "Solution cache needs lock-free 32-bit atomics in shared memory");
+
+static const char cacheMagic[8] = { 'S', 'U', 'D', 'O', 'K', 'U', 'S', 'C' };
+static const uint32_t cacheVersion = 1;
+static const uint32_t maxProbes = 32;
+
+
+////////// CLASS SolutionCache //////////
+
+SolutionCache::SolutionCache()
+{
+    fd = -1;
+    mapping = nullptr;
+    mappingSize = 0;
+    header = nullptr;
+    table = nullptr;
+    slotMask = 0;
+}
+
+SolutionCache::~SolutionCache()
+{
+    close();
+}
+
+void SolutionCache::open(const std::string &path, size_t maxBytes)
+{
+    // open the cache file, creating it if need be with as many table as fit into `maxBytes`
+    // (an existing file keeps the size it was created with)
+    // throw `std::runtime_error` if it cannot be opened
+    close();
+#ifdef _WIN32
+    (void)path;
+    (void)maxBytes;
+    throw std::runtime_error("Solution cache is not supported on this platform");
+#else
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        throw std::runtime_error(path + ": " + std::strerror(errno));
+    if (::flock(fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        close();
+        throw std::runtime_error(path + ": cache file is in use");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        int error = errno;
+        close();
+        throw std::runtime_error(path + ": " + std::strerror(error));
+    }
+
+    bool created = (st.st_size == 0);
+    if (created)
+    {
+        uint32_t slotCount = 1024;
+        while (sizeof(Header) + sizeof(Slot) * size_t(slotCount) * 2 <= maxBytes && slotCount < (1u << 30))
+            slotCount *= 2;
+        mappingSize = sizeof(Header) + sizeof(Slot) * size_t(slotCount);
+        if (::ftruncate(fd, off_t(mappingSize)) != 0)
+        {
+            int error = errno;
+            close();
+            throw std::runtime_error(path + ": " + std::strerror(error));
+        }
+    }
+    else
+        mappingSize = size_t(st.st_size);
+    if (mappingSize < sizeof(Header))
+    {
+        close();
+        throw std::runtime_error(path + ": not a solution cache file");
+    }
+
+    void *address = ::mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        int error = errno;
+        close();
+        throw std::runtime_error(path + ": " + std::strerror(error));
+    }
+    mapping = address;
+    header = static_cast<Header *>(mapping);
+    table = reinterpret_cast<Slot *>(header + 1);
+    if (created)
+    {
+        // (the new file is all zeros, i.e. every slot is empty)
+        std::memcpy(header->magic, cacheMagic, sizeof(cacheMagic));
+        header->version = cacheVersion;
+        header->slotCount = uint32_t((mappingSize - sizeof(Header)) / sizeof(Slot));
+    }
+    uint32_t slotCount = header->slotCount;
+    if (std::memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) != 0 || header->version != cacheVersion
+            || slotCount == 0 || (slotCount & (slotCount - 1)) != 0 || mappingSize != sizeof(Header) + sizeof(Slot) * size_t(slotCount))
+    {
+        close();
+        throw std::runtime_error(path + ": not a solution cache file");
+    }
+    slotMask = slotCount - 1;
+#endif
+}
+
+void SolutionCache::close()
+{
+#ifndef _WIN32
+    if (mapping != nullptr)
+        ::munmap(mapping, mappingSize);
+    if (fd >= 0)
+        ::close(fd);
+#endif
+    fd = -1;
+    mapping = nullptr;
+    mappingSize = 0;
+    header = nullptr;
+    table = nullptr;
+    slotMask = 0;
+}
+
+/*static*/ SolutionCache::Key SolutionCache::keyForCanonical(const BoardState &canonical)
+{
+    // two 64-bit hashes of the 81 numbers, with different multipliers and a final mix
+    // a key is never all 0, which marks an empty slot
+    uint64_t lo = 0x9e3779b97f4a7c15ULL, hi = 0xc2b2ae3d27d4eb4fULL;
+    for (int cell = 0; cell < 81; cell++)
+    {
+        lo = (lo ^ canonical.nums[cell]) * 0x100000001b3ULL;
+        hi = (hi ^ canonical.nums[cell]) * 0xff51afd7ed558ccdULL + uint64_t(cell);
+    }
+    for (uint64_t *h : { &lo, &hi })
+    {
+        *h ^= *h >> 33;
+        *h *= 0xc4ceb9fe1a85ec53ULL;
+        *h ^= *h >> 29;
+    }
+    Key key;
+    key.lo = lo;
+    key.hi = hi | 1;
+    return key;
+}
+
+bool SolutionCache::lookup(const Key &key, BoardState &solution, BoardGrader::Grade &grade)
+{
+    // find an entry, without locking
+    if (!isOpen())
+        return false;
+    for (uint32_t probe = 0; probe < maxProbes; probe++)
+    {
+        Slot &slot(table[(key.lo + probe) & slotMask]);
+        uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if ((sequence & 1) != 0)
+            return false;
+        uint64_t keyLo = slot.keyLo, keyHi = slot.keyHi;
+        bool used = (slot.used != 0);
+        uint8_t packed[BoardState::PackedSize], stepCounts[BoardGrader::PassCount];
+        std::memcpy(packed, slot.solution, sizeof(packed));
+        std::memcpy(stepCounts, slot.stepCounts, sizeof(stepCounts));
+        int hardestPass = slot.hardestPass, rating = slot.rating;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+            return false;
+        if (!used)
+            return false;
+        if (keyLo != key.lo || keyHi != key.hi)
+            continue;
+
+        solution.unpack(packed);
+        grade.hardestPass = hardestPass;
+        grade.rating = rating;
+        grade.solutionCount = 1;
+        grade.stepCounts[0] = 0;
+        for (int pass = 1; pass <= BoardGrader::PassCount; pass++)
+            grade.stepCounts[pass] = stepCounts[pass - 1];
+        // (only store when it changes, to save dirtying the page)
+        uint32_t clock = header->clock.load(std::memory_order_relaxed);
+        if (slot.lastUsed.load(std::memory_order_relaxed) != clock)
+            slot.lastUsed.store(clock, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void SolutionCache::insert(const Key &key, const BoardState &solution, const BoardGrader::Grade &grade)
+{
+    if (!isOpen())
+        return;
+    Slot from;
+    std::memset(static_cast<void *>(&from), 0, sizeof(from));
+    from.keyLo = key.lo;
+    from.keyHi = key.hi;
+    from.used = 1;
+    from.hardestPass = uint8_t(grade.hardestPass);
+    from.rating = uint16_t(grade.rating);
+    for (int pass = 1; pass <= BoardGrader::PassCount; pass++)
+        from.stepCounts[pass - 1] = uint8_t(grade.stepCounts[pass]);
+    solution.pack(from.solution);
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+    from.lastUsed = header->clock.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (header->usedCount.load(std::memory_order_relaxed) >= (slotMask + 1) / 4 * 3 || !insertSlot(from))
+    {
+        compact();
+        insertSlot(from);
+    }
+}
+
+bool SolutionCache::insertSlot(const Slot &from)
+{
+    // put an entry into the first empty slot of its probe sequence (or over the same key)
+    // return false if there is none
+    // (called with `writeMutex` held)
+    for (uint32_t probe = 0; probe < maxProbes; probe++)
+    {
+        Slot &slot(table[(from.keyLo + probe) & slotMask]);
+        if (slot.used != 0 && (slot.keyLo != from.keyLo || slot.keyHi != from.keyHi))
+            continue;
+        if (slot.used == 0)
+            header->usedCount.fetch_add(1, std::memory_order_relaxed);
+        writeSlot(slot, &from);
+        return true;
+    }
+    return false;
+}
+
+void SolutionCache::writeSlot(Slot &slot, const Slot *from)
+{
+    // write a slot (or empty it if `from` is null), with its sequence number odd while it is being written
+    // (called with `writeMutex` held)
+    uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.keyLo = from ? from->keyLo : 0;
+    slot.keyHi = from ? from->keyHi : 0;
+    slot.used = from ? from->used : 0;
+    slot.hardestPass = from ? from->hardestPass : 0;
+    slot.rating = from ? from->rating : 0;
+    if (from)
+    {
+        std::memcpy(slot.stepCounts, from->stepCounts, sizeof(slot.stepCounts));
+        std::memcpy(slot.solution, from->solution, sizeof(slot.solution));
+    }
+    slot.lastUsed.store(from ? from->lastUsed.load(std::memory_order_relaxed) : 0, std::memory_order_relaxed);
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void SolutionCache::compact()
+{
+    // evict entries until the table is half full, least recently used first, and put the rest back
+    // lookups going on meanwhile may miss, but never see a half-written slot
+    // (called with `writeMutex` held)
+    std::vector<uint32_t> order;
+    for (uint32_t index = 0; index <= slotMask; index++)
+        if (table[index].used != 0)
+            order.push_back(index);
+    size_t keepCount = std::min(order.size(), size_t(slotMask + 1) / 2);
+    std::partial_sort(order.begin(), order.begin() + keepCount, order.end(), [this](uint32_t a, uint32_t b)
+    {
+        return table[a].lastUsed.load(std::memory_order_relaxed) > table[b].lastUsed.load(std::memory_order_relaxed);
+    });
+    // (table hold atomics, so cannot go in a vector)
+    std::unique_ptr<Slot[]> kept(new Slot[keepCount]);
+    for (size_t i = 0; i < keepCount; i++)
+    {
+        Slot &slot(table[order[i]]);
+        std::memcpy(static_cast<void *>(&kept[i]), &slot, sizeof(Slot));
+    }
+
+    for (uint32_t index = 0; index <= slotMask; index++)
+        if (table[index].used != 0)
+            writeSlot(table[index], nullptr);
+    header->usedCount.store(0, std::memory_order_relaxed);
+    for (size_t i = 0; i < keepCount; i++)
+        insertSlot(kept[i]);
+}
+
+int SolutionCache::solve(const BoardState &puzzle, BoardState &solution, BoardGrader::Grade *grade /*= nullptr*/)
+{
+    // find a puzzle's solution, and its grade if `grade` is given, from the cache if it is there
+    // return the number of solutions (up to 2, for "more than one"), only filling in `solution` if it is 1
+    // only puzzles with one solution are cached, graded whether or not the caller wants the grade
+    // (with the cache closed and no grade wanted this is just the search)
+    BoardGrader::Grade cachedGrade;
+    bool grading = (grade != nullptr || isOpen());
+    if (grade == nullptr)
+        grade = &cachedGrade;
+    if (puzzle.checkForDuplicates())
+    {
+        *grade = BoardGrader::Grade();
+        return 0;
+    }
+    thread_local BoardCanonicaliser canonicaliser;
+    BoardState canonical, canonicalSolution;
+    BoardCanonicaliser::Transform transform;
+    Key key;
+    if (isOpen())
+    {
+        canonicaliser.canonicalise(puzzle, canonical, &transform);
+        key = keyForCanonical(canonical);
+        if (lookup(key, canonicalSolution, *grade))
+        {
+            transform.unapply(canonicalSolution, solution);
+            return 1;
+        }
+    }
+
+    if (grading)
+        BoardGrader::grade(puzzle, *grade);
+    SearchCursor cursor;
+    int count = 0;
+    BoardSearch::enumerateSolutions(puzzle, [&](const BoardState &found)
+    {
+        if (count++ == 0)
+            solution = found;
+        return true;
+    }, 2, cursor);
+    grade->solutionCount = count;
+    if (count == 1 && isOpen())
+    {
+        transform.apply(solution, canonicalSolution);
+        insert(key, canonicalSolution, *grade);
+    }
+    return count;
+}
@@ -0,0 +1,82 @@
+#ifndef SOLUTIONCACHE_H
+#define SOLUTIONCACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "boardgrader.h"
+#include "boardstate.h"
+
+////////// CLASS SolutionCache //////////
+// a file of puzzles already solved, so that a puzzle seen before (or any equivalent to it) need not be solved again
+// entries are keyed by a 128-bit hash of the puzzle's canonical form and hold its canonical solution and its grade
+// the file is memory-mapped and is an open-addressed hash table of fixed-size slots
+// - lookups take no locks: a slot's sequence number is odd while it is being written,
+//   and a lookup which sees it odd or changed just misses
+// - inserts only ever fill empty slots, one at a time
+// - when the table is 3/4 full it is compacted, keeping the most recently used half of the entries
+// (this departs from an append-only file with compaction: entries are written in place in the table, so a lookup
+// probes the mapping directly and nothing is replayed on opening; a slot left half-written by a crash keeps
+// its odd sequence number, so lookups never use it)
+// only one process can have the file open at a time
+class SolutionCache
+{
+public:
+    struct Key
+    {
+        uint64_t lo, hi;
+    };
+
+    SolutionCache();
+    ~SolutionCache();
+
+    void open(const std::string &path, size_t maxBytes);
+    void close();
+    bool isOpen() const { return (mapping != nullptr); }
+
+    static Key keyForCanonical(const BoardState &canonical);
+    bool lookup(const Key &key, BoardState &solution, BoardGrader::Grade &grade);
+    void insert(const Key &key, const BoardState &solution, const BoardGrader::Grade &grade);
+    int solve(const BoardState &puzzle, BoardState &solution, BoardGrader::Grade *grade = nullptr);
+
+private:
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t slotCount;             // a power of 2
+        std::atomic<uint32_t> usedCount;
+        std::atomic<uint32_t> clock;    // counts inserts, to tell how recently a slot was used
+        uint8_t reserved[40];
+    };
+
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence;
+        std::atomic<uint32_t> lastUsed;
+        uint64_t keyLo, keyHi;
+        uint8_t used;
+        uint8_t hardestPass;
+        uint16_t rating;
+        uint8_t stepCounts[BoardGrader::PassCount];
+        uint8_t solution[BoardState::PackedSize];
+        uint8_t reserved[6];
+    };
+
+    int fd;
+    void *mapping;
+    size_t mappingSize;
+    Header *header;
+    Slot *table;
+    uint32_t slotMask;
+    std::mutex writeMutex;
+
+    bool insertSlot(const Slot &from);
+    void writeSlot(Slot &slot, const Slot *from);
+    void compact();
+};
+
+#endif // SOLUTIONCACHE_H
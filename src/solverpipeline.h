@@ -0,0 +1,226 @@
+#ifndef SOLVERPIPELINE_H
+#define SOLVERPIPELINE_H
+
+#include <climits>
+
+#include "boardsolver.h"
+
+// `BoardSolver`'s techniques as policy types, put together at compile time into a `SolverPipeline`
+// so each build gets a solver with just the techniques it needs, every call inlined and no ordering or flags to check
+// e.g. `SolverPipeline<BoardSolver::NakedSingles, BoardSolver::HiddenSingles>` for a validator using singles alone
+// each technique has `findStep<Earlier>()`, `Earlier` being the pipeline of the techniques before it in the pipeline,
+// and `Pass`, the pass of `BoardSolver::solveFindStep()` it belongs to, which the steps it finds are credited to
+// a technique reducing possibilities goes back to the earlier techniques for a step after each reduction,
+// so the full pipeline finds the same steps as `solveFindStep()` with its usual ordering
+
+
+////////// STRUCT SolverPipelineStages //////////
+// (the techniques of a pipeline from some point on, with the pipeline of those before them)
+template<class Earlier, class... Techniques>
+struct SolverPipelineStages;
+
+template<class... Earlier>
+struct SolverPipelineStages<SolverPipeline<Earlier...> >
+{
+    template<int MaxPass>
+    static CellNum findStep(BoardSolver &, int &pass)
+    {
+        pass = 0;
+        return CellNum();
+    }
+};
+
+template<class... Earlier, class Technique, class... Rest>
+struct SolverPipelineStages<SolverPipeline<Earlier...>, Technique, Rest...>
+{
+    template<int MaxPass>
+    static CellNum findStep(BoardSolver &solver, int &pass)
+    {
+        if (Technique::Pass <= MaxPass)
+        {
+            CellNum cellNum = Technique::template findStep<SolverPipeline<Earlier...> >(solver);
+            if (!cellNum.isEmpty())
+            {
+                pass = Technique::Pass;
+                return cellNum;
+            }
+        }
+        return SolverPipelineStages<SolverPipeline<Earlier..., Technique>, Rest...>::template findStep<MaxPass>(solver, pass);
+    }
+};
+
+
+////////// CLASS SolverPipeline //////////
+template<class... Techniques>
+class SolverPipeline
+{
+public:
+    static CellNum findStep(BoardSolver &solver)
+    {
+        // as `BoardSolver::solveFindStep()`, by this pipeline's techniques: afterwards `solver.lastStepPass()` is the step's pass
+        solver.stepDeadlineSet = false;
+        return findStepUpTo<INT_MAX>(solver, solver._lastStepPass);
+    }
+
+    template<int MaxPass>
+    static CellNum findStepUpTo(BoardSolver &solver, int &pass)
+    {
+        // find a step by the techniques of passes up to `MaxPass` alone (for the techniques going back to earlier ones)
+        return SolverPipelineStages<SolverPipeline<>, Techniques...>::template findStep<MaxPass>(solver, pass);
+    }
+};
+
+
+////////// STRUCTS BoardSolver techniques //////////
+
+struct BoardSolver::NakedSingles
+{
+    enum { Pass = 1 };
+
+    template<class Earlier>
+    static CellNum findStep(BoardSolver &solver) { return solver.solveFindStepPass1(); }
+};
+
+struct BoardSolver::HiddenSingles
+{
+    enum { Pass = 2 };
+
+    template<class Earlier>
+    static CellNum findStep(BoardSolver &solver) { return solver.solveFindStepPass2(); }
+};
+
+struct BoardSolver::IdenticalPairs
+{
+    enum { Pass = 3 };
+
+    template<class Earlier>
+    static CellNum findStep(BoardSolver &solver)
+    {
+        return solver.findStepByReducing<Earlier, &BoardSolver::reduceAllGroupPossibilitiesForIdenticalPairs, false>();
+    }
+};
+
+struct BoardSolver::UniquePairs
+{
+    enum { Pass = 3 };
+
+    template<class Earlier>
+    static CellNum findStep(BoardSolver &solver)
+    {
+        return solver.findStepByReducing<Earlier, &BoardSolver::reduceAllGroupPossibilitiesForUniquePairs, false>();
+    }
+};
+
+struct BoardSolver::RowColumnForSquares
+{
+    enum { Pass = 3 };
+
+    template<class Earlier>
+    static CellNum findStep(BoardSolver &solver)
+    {
+        return solver.findStepByReducing<Earlier, &BoardSolver::reduceAllRowColumnPossibilitiesForSquares, false>();
+    }
+};
+
+struct BoardSolver::XYWings
+{
+    enum { Pass = 4 };
+
+    template<class Earlier>
+    static CellNum findStep(BoardSolver &solver)
+    {
+        solver.startChainTechnique();
+        return solver.findStepByReducing<Earlier, &BoardSolver::reduceAllPossibilitiesForXYWings, true>();
+    }
+};
+
+struct BoardSolver::SimpleColouring
+{
+    enum { Pass = 4 };
+
+    template<class Earlier>
+    static CellNum findStep(BoardSolver &solver)
+    {
+        solver.startChainTechnique();
+        return solver.findStepByReducing<Earlier, &BoardSolver::reduceAllPossibilitiesForSimpleColouring, true>();
+    }
+};
+
+struct BoardSolver::Templates
+{
+    enum { Pass = 4 };
+
+    template<class Earlier>
+    static CellNum findStep(BoardSolver &solver)
+    {
+        solver.startChainTechnique();
+        return solver.findStepByReducing<Earlier, &BoardSolver::reduceAllPossibilitiesForTemplates, true>();
+    }
+};
+
+struct BoardSolver::Chains
+{
+    enum { Pass = 4 };
+
+    template<class Earlier>
+    static CellNum findStep(BoardSolver &solver)
+    {
+        solver.startChainTechnique();
+        return solver.findStepByReducing<Earlier, &BoardSolver::reduceAllPossibilitiesForChainsByStepDeadline, true>();
+    }
+};
+
+struct BoardSolver::Probes
+{
+    enum { Pass = 5 };
+
+    template<class Earlier>
+    static CellNum findStep(BoardSolver &solver)
+    {
+        // as `solveFindStepPass5()`: after each reduction go back to the earlier techniques of passes 1 to 3 only
+        int probes = 0;
+        for (int cell = 0; cell < 81 && probes + 2 <= solver._probeBudget; cell++)
+        {
+            if (solver.state.nums[cell] != 0 || bitCount64(solver.cellPossibilitiesMask(cell)) != 2)
+                continue;
+            probes += 2;
+            if (!solver.reducePossibilitiesForProbesOfCell(cell / 9, cell % 9))
+                continue;
+            int pass;
+            CellNum cellNum = Earlier::template findStepUpTo<3>(solver, pass);
+            if (!cellNum.isEmpty())
+                return cellNum;
+        }
+        return CellNum();
+    }
+};
+
+template<class Earlier, bool (BoardSolver::*Reduce)(), bool UntilDeadline>
+CellNum BoardSolver::findStepByReducing()
+{
+    // reduce possibilities by one technique, going back to the earlier ones for a step after each reduction,
+    // until it reduces no more (or for a chain technique the step's time budget runs out)
+    bool changed;
+    do
+    {
+        changed = (this->*Reduce)();
+        if (changed)
+        {
+            int pass;
+            CellNum cellNum = Earlier::template findStepUpTo<INT_MAX>(*this, pass);
+            if (!cellNum.isEmpty())
+                return cellNum;
+        }
+    } while (changed && (!UntilDeadline || std::chrono::steady_clock::now() < stepDeadline));
+    return CellNum();
+}
+
+
+// the pipelines the builds use
+typedef SolverPipeline<BoardSolver::NakedSingles, BoardSolver::HiddenSingles> SinglesPipeline;
+typedef SolverPipeline<BoardSolver::NakedSingles, BoardSolver::HiddenSingles,
+                       BoardSolver::IdenticalPairs, BoardSolver::UniquePairs, BoardSolver::RowColumnForSquares,
+                       BoardSolver::XYWings, BoardSolver::SimpleColouring, BoardSolver::Templates, BoardSolver::Chains,
+                       BoardSolver::Probes> FullPipeline;
+
+#endif // SOLVERPIPELINE_H
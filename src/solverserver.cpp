@@ -0,0 +1,634 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "boardgrader.h"
+#include "boardsearch.h"
+#include "boardsolver.h"
+#include "puzzletext.h"
+#include "solverserver.h"
+
+static const size_t maxRequestLength = 4096;
+static const size_t maxConnectionRequests = 256;
+static const size_t maxConnectionOutput = size_t(1) << 20;
+static const size_t readSize = 65536;
+static const std::chrono::seconds sessionIdleTime(60);
+static const std::chrono::seconds sessionEvictInterval(10);
+
+
+////////// CLASS SolverServer //////////
+
+SolverServer::SolverServer(SolutionCache &cache, int threadCount, size_t queueLimit)
+    : cache(cache)
+{
+    this->threadCount = std::max(threadCount, 1);
+    this->queueLimit = std::max(queueLimit, size_t(1));
+    listenFd = -1;
+    wakeFds[0] = wakeFds[1] = -1;
+    stopping = false;
+    wakePending = false;
+}
+
+SolverServer::~SolverServer()
+{
+#ifndef _WIN32
+    for (const std::unique_ptr<Connection> &connection : connections)
+        ::close(connection->fd);
+    for (int fd : { listenFd, wakeFds[0], wakeFds[1] })
+        if (fd >= 0)
+            ::close(fd);
+    if (!socketPath.empty())
+        ::unlink(socketPath.c_str());
+#endif
+}
+
+void SolverServer::listen(const std::string &socketPath)
+{
+    // throw on error
+#ifdef _WIN32
+    (void)socketPath;
+    throw std::runtime_error("Solver service is not supported on this platform");
+#else
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+        throw std::runtime_error(socketPath + ": socket path is too long");
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+    // a socket left behind by a server no longer running is replaced, but not one still being served
+    struct stat status;
+    if (::lstat(socketPath.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+    {
+        int probeFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool inUse = (probeFd >= 0 && ::connect(probeFd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0);
+        if (probeFd >= 0)
+            ::close(probeFd);
+        if (inUse)
+            throw std::runtime_error(socketPath + ": socket is already in use");
+        ::unlink(socketPath.c_str());
+    }
+
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+        throw std::runtime_error(socketPath + ": " + std::strerror(errno));
+    if (::bind(listenFd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+        throw std::runtime_error(socketPath + ": " + std::strerror(errno));
+    this->socketPath = socketPath;
+    if (::listen(listenFd, SOMAXCONN) != 0 || ::pipe2(wakeFds, O_NONBLOCK | O_CLOEXEC) != 0)
+        throw std::runtime_error(socketPath + ": " + std::strerror(errno));
+#endif
+}
+
+void SolverServer::stop()
+{
+    // make `run()` return (soon)
+    // only does what is safe in a signal handler
+    stopping = true;
+#ifndef _WIN32
+    char byte = 0;
+    if (wakeFds[1] >= 0 && ::write(wakeFds[1], &byte, 1) < 0)
+        return;
+#endif
+}
+
+void SolverServer::wake()
+{
+    // wake the I/O thread from `poll()`, unless it has already been woken and not yet looked
+    // (a worker calls this after finishing a request)
+#ifndef _WIN32
+    char byte = 0;
+    if (!wakePending.exchange(true) && ::write(wakeFds[1], &byte, 1) < 0)
+        return;
+#endif
+}
+
+void SolverServer::worker()
+{
+    for (;;)
+    {
+        RequestPtr request;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queueChanged.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+            request = queue.front();
+            queue.pop_front();
+        }
+        answerRequest(*request);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            request->done = true;
+        }
+        wake();
+    }
+}
+
+void SolverServer::answerRequest(Request &request)
+{
+    // (on a worker thread)
+    // a request is not started once its deadline has passed, but one already started is always finished
+    if (request.hasDeadline && Clock::now() > request.deadline)
+    {
+        request.answer = "timeout";
+        return;
+    }
+    const BoardState &puzzle(request.puzzle);
+    switch (request.command)
+    {
+    case Solve: {
+        BoardState solution;
+        int count = cache.solve(puzzle, solution);
+        if (count != 1)
+        {
+            request.answer = (count == 0) ? "ok 0" : "ok many";
+            break;
+        }
+        request.answer = "ok ";
+        for (int cell = 0; cell < 81; cell++)
+            request.answer += char('0' + solution.nums[cell]);
+        break;
+    }
+    case Step: {
+        if (puzzle.checkForDuplicates())
+        {
+            request.answer = "error invalid puzzle";
+            break;
+        }
+        BoardSolver solver;
+        solver.state = puzzle;
+        solver.resetAllPossibilities();
+        solver.reduceAllPossibilities();
+        CellNum cellNum = solver.solveFindStep();
+        if (cellNum.isEmpty())
+            request.answer = "ok none";
+        else
+            request.answer = "ok " + std::to_string(cellNum.row + 1) + ' ' + std::to_string(cellNum.col + 1) + ' '
+                    + std::to_string(cellNum.num) + ' ' + std::to_string(solver.lastStepPass());
+        break;
+    }
+    case Grade: {
+        if (puzzle.checkForDuplicates())
+        {
+            request.answer = "error invalid puzzle";
+            break;
+        }
+        BoardGrader::Grade grade;
+        if (cache.isOpen())
+        {
+            BoardState solution;
+            cache.solve(puzzle, solution, &grade);
+        }
+        else
+            BoardGrader::grade(puzzle, grade);
+        if (!grade.hasOneSolution())
+        {
+            request.answer = std::string("error ") + BoardGrader::solutionCountName(grade.solutionCount) + " puzzle";
+            break;
+        }
+        request.answer = "ok " + std::to_string(grade.rating) + ' ' + BoardGrader::tierName(grade.tier()) + ' ';
+        for (int pass = 1; pass <= BoardGrader::PassCount; pass++)
+            request.answer += std::to_string(grade.stepCounts[pass]) + ((pass < BoardGrader::PassCount) ? "," : "");
+        break;
+    }
+    case CheckUnique:
+        switch (BoardSearch::countSolutions(puzzle, 2))
+        {
+        case 0: request.answer = "ok 0"; break;
+        case 1: request.answer = "ok 1"; break;
+        default: request.answer = "ok many"; break;
+        }
+        break;
+    case SessionNew: {
+        SessionManager::SessionId id = sessions.create(puzzle);
+        request.answer = (id != 0) ? "ok " + std::to_string(id) : "error invalid puzzle";
+        break;
+    }
+    case SessionBoard: {
+        BoardState state;
+        if (!sessions.board(request.session, state))
+        {
+            request.answer = "error unknown session";
+            break;
+        }
+        request.answer = "ok ";
+        for (int cell = 0; cell < 81; cell++)
+            request.answer += char('0' + state.nums[cell]);
+        break;
+    }
+    case SessionHint:
+    case SessionStep: {
+        CellNum cellNum;
+        if (!((request.command == SessionHint) ? sessions.hint(request.session, cellNum) : sessions.step(request.session, cellNum)))
+            request.answer = "error unknown session";
+        else if (cellNum.isEmpty())
+            request.answer = "ok none";
+        else
+            request.answer = "ok " + std::to_string(cellNum.row + 1) + ' ' + std::to_string(cellNum.col + 1) + ' ' + std::to_string(cellNum.num);
+        break;
+    }
+    case SessionEdit:
+    case SessionUndo:
+    case SessionRedo: {
+        bool done = (request.command == SessionEdit) ? sessions.edit(request.session, request.row, request.col, request.num)
+                : (request.command == SessionUndo) ? sessions.undo(request.session) : sessions.redo(request.session);
+        BoardState state;
+        if (done)
+            request.answer = "ok";
+        else if (!sessions.board(request.session, state))
+            request.answer = "error unknown session";
+        else
+            request.answer = (request.command == SessionEdit) ? "error invalid edit"
+                    : (request.command == SessionUndo) ? "error nothing to undo" : "error nothing to redo";
+        break;
+    }
+    case SessionClose:
+        request.answer = sessions.remove(request.session) ? "ok" : "error unknown session";
+        break;
+    }
+}
+
+static bool parseNumber(const char *&pos, const char *end, uint64_t &value)
+{
+    // a number after any spaces, moving `pos` past it
+    while (pos < end && *pos == ' ')
+        pos++;
+    const char *start = pos;
+    value = 0;
+    for (; pos < end && *pos >= '0' && *pos <= '9' && pos - start < 18; pos++)
+        value = value * 10 + uint64_t(*pos - '0');
+    return pos > start && (pos == end || *pos == ' ' || *pos == '\t');
+}
+
+SolverServer::RequestPtr SolverServer::parseRequest(const char *text, size_t length, bool framed) const
+{
+    // parse the text of a request, "COMMAND PUZZLE [DEADLINE]" or "COMMAND ID [ROW COL NUM] [DEADLINE]" for a session
+    // return a request already done, with an error for its answer, if it cannot be parsed
+    static const struct { const char *name; Command command; } commands[] =
+        { { "solve", Solve }, { "step", Step }, { "grade", Grade }, { "check-unique", CheckUnique },
+          { "session-new", SessionNew }, { "session-board", SessionBoard }, { "session-hint", SessionHint },
+          { "session-step", SessionStep }, { "session-edit", SessionEdit }, { "session-undo", SessionUndo },
+          { "session-redo", SessionRedo }, { "session-close", SessionClose } };
+    const char *end = text + length;
+    const char *space = std::find(text, end, ' ');
+    RequestPtr request(new Request);
+    size_t nameLength = size_t(space - text);
+    bool known = false;
+    for (const auto &command : commands)
+        if (std::strlen(command.name) == nameLength && std::memcmp(command.name, text, nameLength) == 0)
+        {
+            request->command = command.command;
+            known = true;
+        }
+    if (!known)
+        return errorRequest("error unknown command", framed);
+
+    const char *pos = space;
+    if (request->command <= SessionNew)
+    {
+        while (pos < end && *pos == ' ')
+            pos++;
+        if (!PuzzleTextParser::parseLine(pos, size_t(end - pos), request->puzzle))
+            return errorRequest("error invalid puzzle", framed);
+        pos += 81;
+    }
+    else
+    {
+        // (an edit out of range is left to `SessionManager::edit()` to refuse)
+        uint64_t values[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < ((request->command == SessionEdit) ? 4 : 1); i++)
+            if (!parseNumber(pos, end, values[i]))
+                return errorRequest("error invalid session request", framed);
+        request->session = values[0];
+        request->row = int(std::min(values[1], uint64_t(10))) - 1;
+        request->col = int(std::min(values[2], uint64_t(10))) - 1;
+        request->num = int(std::min(values[3], uint64_t(10)));
+    }
+    request->sessionRequest = (request->command >= SessionNew);
+    while (pos < end && (*pos == ' ' || *pos == '\t'))
+        pos++;
+    request->hasDeadline = (pos < end);
+    if (request->hasDeadline)
+    {
+        long milliseconds = 0;
+        for (; pos < end && *pos >= '0' && *pos <= '9' && milliseconds < 100000000; pos++)
+            milliseconds = milliseconds * 10 + (*pos - '0');
+        if (pos != end)
+            return errorRequest("error invalid deadline", framed);
+        request->deadline = Clock::now() + std::chrono::milliseconds(milliseconds);
+    }
+    request->framed = framed;
+    request->done = false;
+    return request;
+}
+
+/*static*/ SolverServer::RequestPtr SolverServer::errorRequest(const char *message, bool framed)
+{
+    RequestPtr request(new Request);
+    request->sessionRequest = false;
+    request->hasDeadline = false;
+    request->framed = framed;
+    request->done = true;
+    request->answer = message;
+    return request;
+}
+
+/*static*/ void SolverServer::appendMessage(std::string &output, const std::string &text, bool framed)
+{
+    // append an answer to be written, framed like the request it answers
+    if (framed)
+    {
+        uint32_t length = uint32_t(text.size());
+        const char prefix[4] = { char(length >> 24), char(length >> 16), char(length >> 8), char(length) };
+        output.append(prefix, sizeof(prefix)).append(text);
+    }
+    else
+        output.append(text).push_back('\n');
+}
+
+void SolverServer::parseConnectionInput(Connection &connection, size_t &room, std::vector<RequestPtr> &parsed)
+{
+    // parse the whole requests read from a connection, as many as there is room for, adding those to be worked on to `parsed`
+    // a request too long to be believed gets an error, and the connection is closed after answering it
+    // a session request is held back while the connection has one before it not yet answered, with nothing parsed after it
+    if (connection.heldRequest && connection.sessionRequestsPending == 0 && room > 0)
+    {
+        parsed.push_back(connection.heldRequest);
+        room--;
+        connection.sessionRequestsPending++;
+        connection.heldRequest.reset();
+    }
+    if (connection.heldRequest)
+        return;
+    std::string &input(connection.input);
+    size_t pos = 0;
+    bool incomplete = false;
+    while (pos < input.size() && room > 0 && connection.requests.size() < maxConnectionRequests)
+    {
+        const char *start = input.data() + pos;
+        size_t available = input.size() - pos;
+        RequestPtr request;
+        if (start[0] == '\0')
+        {
+            if (available < 4)
+            {
+                incomplete = true;
+                break;
+            }
+            const uint8_t *prefix = reinterpret_cast<const uint8_t *>(start);
+            size_t length = (size_t(prefix[0]) << 24) | (size_t(prefix[1]) << 16) | (size_t(prefix[2]) << 8) | prefix[3];
+            if (length > maxRequestLength)
+            {
+                request = errorRequest("error request too long", true);
+                connection.closing = true;
+                pos = input.size();
+            }
+            else if (available < 4 + length)
+            {
+                incomplete = true;
+                break;
+            }
+            else
+            {
+                request = parseRequest(start + 4, length, true);
+                pos += 4 + length;
+            }
+        }
+        else
+        {
+            const char *newline = static_cast<const char *>(std::memchr(start, '\n', available));
+            if (newline == nullptr && available <= maxRequestLength)
+            {
+                incomplete = true;
+                break;
+            }
+            if (newline == nullptr)
+            {
+                request = errorRequest("error request too long", false);
+                connection.closing = true;
+                pos = input.size();
+            }
+            else
+            {
+                size_t length = size_t(newline - start);
+                pos += length + 1;
+                if (length > 0 && start[length - 1] == '\r')
+                    length--;
+                if (length == 0)
+                    continue;
+                request = parseRequest(start, length, false);
+            }
+        }
+        connection.requests.push_back(request);
+        if (!request->done)
+        {
+            if (request->sessionRequest && connection.sessionRequestsPending > 0)
+            {
+                connection.heldRequest = request;
+                break;
+            }
+            if (request->sessionRequest)
+                connection.sessionRequestsPending++;
+            parsed.push_back(request);
+            room--;
+        }
+    }
+    input.erase(0, pos);
+    // a part request left when the connection has nothing more to send can never be finished
+    if (incomplete && connection.closing)
+        input.clear();
+}
+
+bool SolverServer::connectionCanRead(const Connection &connection, size_t room) const
+{
+    // whether to read more from a connection, or hold it back until the workers catch up or it reads its answers
+    return !connection.closing && room > 0 && connection.requests.size() < maxConnectionRequests
+            && connection.output.size() < maxConnectionOutput && connection.input.size() <= maxRequestLength + 4;
+}
+
+/*static*/ void SolverServer::dropConnection(Connection &connection)
+{
+    // give up on a connection which has failed: it is closed without waiting for any answers
+    // (workers still on its requests hold on to them until they finish)
+    connection.closing = true;
+    connection.input.clear();
+    connection.output.clear();
+    connection.requests.clear();
+    connection.sessionRequestsPending = 0;
+    connection.heldRequest.reset();
+}
+
+#ifndef _WIN32
+void SolverServer::acceptConnections()
+{
+    for (;;)
+    {
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        std::unique_ptr<Connection> connection(new Connection);
+        connection->fd = fd;
+        connection->closing = false;
+        connection->sessionRequestsPending = 0;
+        connections.push_back(std::move(connection));
+    }
+}
+
+void SolverServer::readConnection(Connection &connection)
+{
+    char buffer[readSize];
+    ssize_t count = ::recv(connection.fd, buffer, sizeof(buffer), 0);
+    if (count > 0)
+        connection.input.append(buffer, size_t(count));
+    else if (count == 0)
+        connection.closing = true;
+    else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        dropConnection(connection);
+}
+
+void SolverServer::writeConnection(Connection &connection)
+{
+    // write as much of the answers as the socket will take
+    ssize_t count = ::send(connection.fd, connection.output.data(), connection.output.size(), MSG_NOSIGNAL);
+    if (count > 0)
+        connection.output.erase(0, size_t(count));
+    else if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        dropConnection(connection);
+}
+#else
+void SolverServer::acceptConnections() {}
+void SolverServer::readConnection(Connection &) {}
+void SolverServer::writeConnection(Connection &) {}
+#endif
+
+void SolverServer::run()
+{
+    // serve requests until `stop()` is called
+    // (`listen()` must have succeeded)
+#ifndef _WIN32
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threadCount; i++)
+        workers.emplace_back(&SolverServer::worker, this);
+
+    std::vector<RequestPtr> parsed;
+    std::vector<pollfd> pollFds;
+    Clock::time_point lastEvicted(Clock::now());
+    while (!stopping)
+    {
+        // collect the answers done, in each connection's order
+        // (first, so that a session request held back for the one before it goes to the workers straight away)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const std::unique_ptr<Connection> &connection : connections)
+                while (!connection->requests.empty() && connection->requests.front()->done)
+                {
+                    const Request &request(*connection->requests.front());
+                    appendMessage(connection->output, request.answer, request.framed);
+                    if (request.sessionRequest)
+                        connection->sessionRequestsPending--;
+                    connection->requests.pop_front();
+                }
+        }
+
+        // hand the new requests from all connections to the workers together
+        // (only this thread adds to the queue, so the room there can only grow meanwhile)
+        size_t room;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            room = queueLimit - std::min(queue.size(), queueLimit);
+        }
+        parsed.clear();
+        for (const std::unique_ptr<Connection> &connection : connections)
+            parseConnectionInput(*connection, room, parsed);
+        if (!parsed.empty())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.insert(queue.end(), parsed.begin(), parsed.end());
+            }
+            if (parsed.size() == 1)
+                queueChanged.notify_one();
+            else
+                queueChanged.notify_all();
+        }
+
+        // write the answers straight away if the sockets will take them
+        for (size_t i = 0; i < connections.size(); )
+        {
+            Connection &connection(*connections[i]);
+            if (!connection.output.empty())
+                writeConnection(connection);
+            if (connection.closing && connection.requests.empty() && connection.output.empty() && connection.input.empty())
+            {
+                ::close(connection.fd);
+                connections.erase(connections.begin() + long(i));
+            }
+            else
+                i++;
+        }
+
+        pollFds.clear();
+        pollFds.push_back(pollfd { wakeFds[0], POLLIN, 0 });
+        pollFds.push_back(pollfd { listenFd, POLLIN, 0 });
+        for (const std::unique_ptr<Connection> &connection : connections)
+        {
+            short events = 0;
+            if (connectionCanRead(*connection, room))
+                events |= POLLIN;
+            if (!connection->output.empty())
+                events |= POLLOUT;
+            pollFds.push_back(pollfd { connection->fd, events, 0 });
+        }
+        // (waking now and then while there are sessions, to evict those left idle)
+        if (sessions.residentCount() > 0 && Clock::now() - lastEvicted >= sessionEvictInterval)
+        {
+            sessions.evictIdle(sessionIdleTime);
+            lastEvicted = Clock::now();
+        }
+        int timeout = (sessions.residentCount() > 0) ? int(std::chrono::milliseconds(sessionEvictInterval).count()) : -1;
+        if (::poll(pollFds.data(), pollFds.size(), timeout) < 0)
+            continue;
+
+        if (pollFds[0].revents != 0)
+        {
+            wakePending = false;
+            char buffer[256];
+            while (::read(wakeFds[0], buffer, sizeof(buffer)) > 0)
+                ;
+        }
+        if (pollFds[1].revents != 0)
+            acceptConnections();
+        for (size_t i = 2; i < pollFds.size(); i++)
+        {
+            Connection &connection(*connections[i - 2]);
+            short revents = pollFds[i].revents;
+            if ((revents & POLLIN) != 0)
+                readConnection(connection);
+            else if ((revents & (POLLHUP | POLLERR)) != 0)
+                dropConnection(connection);
+            if ((revents & POLLOUT) != 0 && !connection.output.empty())
+                writeConnection(connection);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.clear();
+    }
+    queueChanged.notify_all();
+    for (std::thread &thread : workers)
+        thread.join();
+#endif
+}
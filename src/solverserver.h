@@ -0,0 +1,109 @@
+#ifndef SOLVERSERVER_H
+#define SOLVERSERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boardstate.h"
+#include "sessionmanager.h"
+#include "solutioncache.h"
+
+////////// CLASS SolverServer //////////
+// a long-running service answering puzzle requests over a Unix domain socket, so callers need not start a process for each
+// a request is a line "COMMAND PUZZLE [DEADLINE]", COMMAND being "solve", "step", "grade" or "check-unique",
+// PUZZLE 81 characters and DEADLINE how many milliseconds the caller will wait for the answer
+// or "session-new PUZZLE [DEADLINE]" to start an interactive solving session (see `SessionManager`), and then on its ID
+// "session-board ID", "session-hint ID", "session-step ID", "session-edit ID ROW COL NUM" (from 1, NUM 0 to clear a cell),
+// "session-undo ID", "session-redo ID" and "session-close ID", each with a DEADLINE too if wanted
+// or the same text without the newline, prefixed by its length as 4 bytes big-endian (so it starts with a 0 byte)
+// each answer is framed the same way as its request, and a connection's answers come back in the order of its requests:
+// - "ok RESULT", RESULT being as for the batch mode of the same name without the puzzle,
+//   or for "step" the row and column (from 1), the number and the solver pass of the next step, or "none"
+//   for "session-new" the session's ID, for "session-board" its 81 numbers, for "session-hint" and "session-step"
+//   the row, column and number of the next step (or "none"), and nothing for the other session requests
+// - "error MESSAGE" for a request which could not be understood, or a puzzle to grade with no solution
+//   ("error invalid puzzle") or more than one ("error not-unique puzzle")
+// - "timeout" for a request whose deadline had passed before a worker got to it
+// a connection's session requests are done one at a time, in order, so each sees the ones before it
+// (requests on the same session from different connections are not ordered)
+// a session left idle for a minute is evicted to its compact form until it is next used
+// one thread does all the socket I/O, handing the requests from every connection to a shared pool of worker threads
+// it stops reading sockets while `queueLimit` requests are waiting for a worker or a connection has too many answers
+// waiting, so clients are held back by their sockets' buffers filling up
+class SolverServer
+{
+public:
+    SolverServer(SolutionCache &cache, int threadCount, size_t queueLimit);
+    ~SolverServer();
+
+    void listen(const std::string &socketPath);
+    void run();
+    void stop();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    // (the session commands come last, "session-new" first)
+    enum Command { Solve, Step, Grade, CheckUnique, SessionNew, SessionBoard, SessionHint, SessionStep, SessionEdit, SessionUndo, SessionRedo, SessionClose };
+
+    struct Request
+    {
+        Command command;
+        BoardState puzzle;
+        SessionManager::SessionId session;
+        int row, col, num;      // for "session-edit", from 0
+        bool sessionRequest;    // a session request, done one at a time on its connection
+        bool hasDeadline;
+        Clock::time_point deadline;
+        bool framed;
+        bool done;              // (guarded by `mutex`)
+        std::string answer;
+    };
+    typedef std::shared_ptr<Request> RequestPtr;
+
+    struct Connection
+    {
+        int fd;
+        std::string input, output;
+        std::deque<RequestPtr> requests;    // in the order received, until their answers are in `output`
+        bool closing;                       // nothing more to read: close once all answers have been written
+        size_t sessionRequestsPending;      // session requests given to the workers and not yet answered
+        RequestPtr heldRequest;             // a session request waiting for those, with nothing more parsed after it
+    };
+
+    SolutionCache &cache;
+    SessionManager sessions;
+    int threadCount;
+    size_t queueLimit;
+    std::string socketPath;
+    int listenFd;
+    int wakeFds[2];
+    std::atomic<bool> stopping;
+    std::atomic<bool> wakePending;
+    std::mutex mutex;
+    std::condition_variable queueChanged;
+    std::deque<RequestPtr> queue;
+    std::vector<std::unique_ptr<Connection> > connections;
+
+    void wake();
+    void worker();
+    void answerRequest(Request &request);
+    RequestPtr parseRequest(const char *text, size_t length, bool framed) const;
+    static RequestPtr errorRequest(const char *message, bool framed);
+    static void appendMessage(std::string &output, const std::string &text, bool framed);
+    void parseConnectionInput(Connection &connection, size_t &room, std::vector<RequestPtr> &parsed);
+    bool connectionCanRead(const Connection &connection, size_t room) const;
+    void acceptConnections();
+    void readConnection(Connection &connection);
+    void writeConnection(Connection &connection);
+    static void dropConnection(Connection &connection);
+};
+
+#endif // SOLVERSERVER_H
@@ -0,0 +1,90 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+////////// CLASS SpscQueue //////////
+// a bounded queue between one producer thread and one consumer thread, as a ring of slots with no locks
+// `push()` waits while the queue is full, holding the producer back, and `pop()` while it is empty
+// each side adds up how long it has waited, to tell which of the threads either side of it is holding things up
+// (waiting spins a little, then sleeps for short spells, as the items are large pieces of work and rarely come close together)
+template<class T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity)
+        : slots(capacity + 1)
+    {
+        head = tail = 0;
+        pushWaited = popWaited = std::chrono::nanoseconds::zero();
+    }
+
+    bool tryPush(T &item)
+    {
+        size_t at = tail.load(std::memory_order_relaxed), next = (at + 1) % slots.size();
+        if (next == head.load(std::memory_order_acquire))
+            return false;
+        slots[at] = std::move(item);
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &item)
+    {
+        size_t at = head.load(std::memory_order_relaxed);
+        if (at == tail.load(std::memory_order_acquire))
+            return false;
+        item = std::move(slots[at]);
+        head.store((at + 1) % slots.size(), std::memory_order_release);
+        return true;
+    }
+
+    void push(T item)
+    {
+        if (tryPush(item))
+            return;
+        Clock::time_point start(Clock::now());
+        for (int tries = 0; !tryPush(item); tries++)
+            wait(tries);
+        pushWaited += Clock::now() - start;
+    }
+
+    void pop(T &item)
+    {
+        if (tryPop(item))
+            return;
+        Clock::time_point start(Clock::now());
+        for (int tries = 0; !tryPop(item); tries++)
+            wait(tries);
+        popWaited += Clock::now() - start;
+    }
+
+    // (each only to be read by its own side, or once both sides are done)
+    std::chrono::nanoseconds pushWaitTime() const { return pushWaited; }
+    std::chrono::nanoseconds popWaitTime() const { return popWaited; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // (the consumer's and the producer's members each on a cache line of their own)
+    std::vector<T> slots;                       // one more than the capacity, so that full and empty differ
+    alignas(64) std::atomic<size_t> head;       // next slot to pop, moved on by the consumer
+    std::chrono::nanoseconds popWaited;
+    alignas(64) std::atomic<size_t> tail;       // next slot to push, moved on by the producer
+    std::chrono::nanoseconds pushWaited;
+
+    static void wait(int tries)
+    {
+        if (tries < 64)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+};
+
+#endif // SPSCQUEUE_H
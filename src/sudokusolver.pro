@@ -16,11 +16,49 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    batchsolver.cpp \
+    boardcanonicaliser.cpp \
+    boardgrader.cpp \
+    boardlayout.cpp \
+    boardsearch.cpp \
+    boardsolver.cpp \
+    boardstate.cpp \
+    collectionbrowser.cpp \
+    gridvalidator.cpp \
+    guibenchmark.cpp \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    puzzlecorpus.cpp \
+    puzzlegenerator.cpp \
+    puzzletext.cpp \
+    sessionmanager.cpp \
+    solutioncache.cpp \
+    solverserver.cpp \
+    workerpool.cpp
 
 HEADERS += \
-    mainwindow.h
+    batchsolver.h \
+    bitboard.h \
+    boardcanonicaliser.h \
+    boardgrader.h \
+    boardlayout.h \
+    boardsearch.h \
+    boardsolver.h \
+    boardstate.h \
+    collectionbrowser.h \
+    gridvalidator.h \
+    guibenchmark.h \
+    mainwindow.h \
+    puzzlecorpus.h \
+    puzzlegenerator.h \
+    puzzletext.h \
+    sessionmanager.h \
+    sizedboard.h \
+    solutioncache.h \
+    solverpipeline.h \
+    solverserver.h \
+    spscqueue.h \
+    workerpool.h
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -0,0 +1,86 @@
+#include <algorithm>
+
+#include "workerpool.h"
+
+
+////////// CLASS WorkerPool //////////
+
+WorkerPool::WorkerPool(int threadCount)
+{
+    // (the calling thread is the first worker, so one fewer threads are started)
+    work = nullptr;
+    count = 0;
+    nextIndex = 0;
+    callNumber = 0;
+    busyCount = 0;
+    stopping = false;
+    for (int worker = 1; worker < std::max(threadCount, 1); worker++)
+        threads.emplace_back(&WorkerPool::threadMain, this, worker);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workReady.notify_all();
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+void WorkerPool::forEachIndex(size_t count, const Work &work)
+{
+    // call `work` for each index from 0 up to `count`, shared out across all the threads, returning once all are done
+    // `worker` is which of the threads it is on, 0 up to `threadCount()`, 0 being the calling thread
+    // (not to be called from more than one thread at once)
+    if (count == 0)
+        return;
+    if (threads.empty() || count == 1)
+    {
+        for (size_t index = 0; index < count; index++)
+            work(index, 0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->work = &work;
+        this->count = count;
+        nextIndex = 0;
+        busyCount = int(threads.size());
+        callNumber++;
+    }
+    workReady.notify_all();
+    runWork(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    workDone.wait(lock, [this]() { return busyCount == 0; });
+    this->work = nullptr;
+}
+
+void WorkerPool::threadMain(int worker)
+{
+    uint64_t callsJoined = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workReady.wait(lock, [&]() { return stopping || callNumber != callsJoined; });
+            if (stopping)
+                return;
+            callsJoined = callNumber;
+        }
+        runWork(worker);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busyCount == 0)
+                workDone.notify_one();
+        }
+    }
+}
+
+void WorkerPool::runWork(int worker)
+{
+    // take indexes of the current call until there are none left
+    for (size_t index = nextIndex++; index < count; index = nextIndex++)
+        (*work)(index, worker);
+}
@@ -0,0 +1,44 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+////////// CLASS WorkerPool //////////
+// a set of worker threads started once and kept for as long as the pool, which `forEachIndex()` shares work out across
+// the calling thread works too, as worker 0, and each of the pool's threads is always the same worker number,
+// so that work can keep state per worker for the whole run
+// (the threads wait on a condition variable between calls, so a call costs a wake-up rather than starting threads)
+class WorkerPool
+{
+public:
+    typedef std::function<void(size_t index, int worker)> Work;
+
+    explicit WorkerPool(int threadCount);
+    ~WorkerPool();
+
+    int threadCount() const { return int(threads.size()) + 1; }
+    void forEachIndex(size_t count, const Work &work);
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable workReady, workDone;
+    const Work *work;               // the call's work, and how many indexes it has
+    size_t count;
+    std::atomic<size_t> nextIndex;
+    uint64_t callNumber;            // counts the calls, so each thread joins each call once (guarded by `mutex`)
+    int busyCount;                  // threads still on the call (guarded by `mutex`)
+    bool stopping;                  // (guarded by `mutex`)
+
+    void threadMain(int worker);
+    void runWork(int worker);
+};
+
+#endif // WORKERPOOL_H